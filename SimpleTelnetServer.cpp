@@ -18,19 +18,209 @@
 
     Extends supports of TelnetServer base class:
 
+    RFC 1073 - TELNET WINDOW SIZE OPTION
     RFC 1079 - TELNET TERMINAL SPEED OPTION
+    RFC 1091 - TELNET TERMINAL-TYPE OPTION
+    RFC 1572 - TELNET ENVIRONMENT OPTION
 */
 
 #include "SimpleTelnetServer.h"
 
-SimpleTelnetServer::SimpleTelnetServer()
+static_assert(TELNET_RECV_BUFFER_SIZE <= (TelnetIndex)-1, "TelnetIndex cannot address TELNET_RECV_BUFFER_SIZE");
+
+// CR, LF and NUL all end a line
+static inline bool _isLineEnd(uint8_t c)
+{
+    return c == '\r' || c == '\n' || c == 0;
+}
+
+SimpleTelnetServer::SimpleTelnetServer() :
+    recvBuffer(new uint8_t[TELNET_RECV_BUFFER_SIZE]),
+    recvBufLen(0),
+    recvBufSize(TELNET_RECV_BUFFER_SIZE),
+    _lineLen(0),
+    _discarding(false),
+    _ownsRecvBuffer(true),
+    _terminal(),
+    _capabilityCache(NULL),
+    _txSpeed(9600),
+    _rxSpeed(9600)
+{
+}
+
+SimpleTelnetServer::SimpleTelnetServer(int port) :
+    TelnetServer(port),
+    recvBuffer(new uint8_t[TELNET_RECV_BUFFER_SIZE]),
+    recvBufLen(0),
+    recvBufSize(TELNET_RECV_BUFFER_SIZE),
+    _lineLen(0),
+    _discarding(false),
+    _ownsRecvBuffer(true),
+    _terminal(),
+    _capabilityCache(NULL),
+    _txSpeed(9600),
+    _rxSpeed(9600)
+{
+}
+
+SimpleTelnetServer::SimpleTelnetServer(int port, uint8_t *recvStorage, TelnetIndex recvSize) :
+    TelnetServer(port),
+    recvBuffer(recvStorage),
+    recvBufLen(0),
+    recvBufSize(recvSize),
+    _lineLen(0),
+    _discarding(false),
+    _ownsRecvBuffer(false),
+    _terminal(),
+    _capabilityCache(NULL),
+    _txSpeed(9600),
+    _rxSpeed(9600)
 {
-    recvBufLen = 0;
 }
 
 SimpleTelnetServer::~SimpleTelnetServer()
 {
     end();
+
+    if (_ownsRecvBuffer)
+        delete[] recvBuffer;
+}
+
+char *SimpleTelnetServer::readLine()
+{
+    // drop the line we handed out last time
+    if (_lineLen > 0)
+    {
+        if (_lineLen < recvBufLen)
+        {
+            memmove(&recvBuffer[0], &recvBuffer[_lineLen], recvBufLen - _lineLen);
+            recvBufLen -= _lineLen;
+        }
+        else
+            recvBufLen = 0;
+
+        _lineLen = 0;
+    }
+
+    // skip the tail of a CR LF / CR NUL pair, or empty lines
+    TelnetIndex start = 0;
+    while (start < recvBufLen && _isLineEnd(recvBuffer[start]))
+        start++;
+
+    if (start > 0)
+    {
+        memmove(&recvBuffer[0], &recvBuffer[start], recvBufLen - start);
+        recvBufLen -= start;
+    }
+
+    for (TelnetIndex i = 0; i < recvBufLen; i++)
+    {
+        if (_isLineEnd(recvBuffer[i]))
+        {
+            recvBuffer[i] = 0;
+            _lineLen = i + 1;
+            return (char*)&recvBuffer[0];
+        }
+    }
+
+    // full without a line end, drop it and the rest of the line
+    if (recvBufLen == recvBufSize)
+    {
+        recvBufLen = 0;
+        _discarding = true;
+    }
+
+    return NULL;
+}
+
+size_t SimpleTelnetServer::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t SimpleTelnetServer::write(const uint8_t *buf, size_t size)
+{
+    if (!_client)
+        return 0;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        // leave room for an escaped IAC
+        if (_clientStr->bufferLen + 2 > _clientStr->bufferSize)
+            _flush(_client, *_clientStr);
+
+        if (buf[i] == TELNET_IAC)
+            _clientStr->buffer[_clientStr->bufferLen++] = TELNET_IAC;
+
+        _clientStr->buffer[_clientStr->bufferLen++] = buf[i];
+    }
+
+    return size;
+}
+
+bool SimpleTelnetServer::writeReady(size_t size)
+{
+    if (!_client || _clientStr == NULL)
+        return false;
+
+    return _clientStr->bufferLen == 0 || _clientStr->bufferLen + size <= _clientStr->bufferSize;
+}
+
+const char *SimpleTelnetServer::terminalType()
+{
+    if (!_client || _clientStr == NULL)
+        return "";
+
+    return _terminal.termType;
+}
+
+const char *SimpleTelnetServer::user()
+{
+    if (!_client || _clientStr == NULL)
+        return "";
+
+    return _terminal.user;
+}
+
+bool SimpleTelnetServer::terminalReady()
+{
+    if (!_client || _clientStr == NULL)
+        return false;
+
+    // each is known, presumed from the cache, or not coming at all
+    bool type = _terminal.termKnown || (_terminal.optPresumed & TELNET_CAP_TTYPE) ||
+                !((_terminal.optRequested | _terminal.optEnabled) & TELNET_CAP_TTYPE);
+    bool size = _terminal.sizeKnown || (_terminal.optPresumed & TELNET_CAP_NAWS) ||
+                !((_terminal.optRequested | _terminal.optEnabled) & TELNET_CAP_NAWS);
+
+    return type && size;
+}
+
+uint16_t SimpleTelnetServer::windowWidth()
+{
+    if (!_client || _clientStr == NULL)
+        return 0;
+
+    return _terminal.cols;
+}
+
+uint16_t SimpleTelnetServer::windowHeight()
+{
+    if (!_client || _clientStr == NULL)
+        return 0;
+
+    return _terminal.rows;
+}
+
+void SimpleTelnetServer::setTerminalSpeed(unsigned long txSpeed, unsigned long rxSpeed)
+{
+    _txSpeed = txSpeed;
+    _rxSpeed = rxSpeed;
+}
+
+void SimpleTelnetServer::setCapabilityCache(TelnetCapabilityCache *cache)
+{
+    _capabilityCache = cache;
 }
 
 /*
@@ -50,8 +240,21 @@ bool SimpleTelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
             str.bufferLen++;
         }
 
-        recvBuffer[recvBufLen] = str.opt0;
-        recvBufLen++;
+        // the rest of an overlong line, up to and including its end
+        if (_discarding)
+        {
+            if (_isLineEnd(str.opt0))
+                _discarding = false;
+
+            return true;
+        }
+
+        // _canReceive() made sure there is room
+        if (recvBufLen < recvBufSize)
+        {
+            recvBuffer[recvBufLen] = str.opt0;
+            recvBufLen++;
+        }
 
         return true;
     }
@@ -85,16 +288,25 @@ bool SimpleTelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
             }
             case TELNET_EC: // erase last character
             {
-                if (str.echo)
+                // take back the last received character, unless it is
+                // part of a line already ended (or handed out).
+                if (recvBufLen > _lineLen)
                 {
-                    if (str.buffer[str.bufferLen] > 0)
+                    if (!_isLineEnd(recvBuffer[recvBufLen - 1]))
                     {
-                        str.buffer[str.bufferLen] = 0;
-                        str.bufferLen--;
+                        recvBufLen--;
+
+                        // and rub it out on the client's screen
+                        if (str.echo)
+                        {
+                            str.buffer[str.bufferLen++] = '\b';
+                            str.buffer[str.bufferLen++] = ' ';
+                            str.buffer[str.bufferLen++] = '\b';
+                        }
                     }
                 }
 
-                _clientStr.clientState = Normal;
+                str.clientState = Normal;
                 return true;
             }
             case TELNET_EL: // erase current line
@@ -103,7 +315,7 @@ bool SimpleTelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
                 DEBUG_TELNET.print("Unsupported telnet option:");
                 DEBUG_TELNET.println(str.opt0, HEX);
     #endif
-                _clientStr.clientState = Normal;
+                str.clientState = Normal;
                 return true;
             }
             case TELNET_IP: // interrupt process ---- what to do...?
@@ -112,7 +324,7 @@ bool SimpleTelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
                 DEBUG_TELNET.print("Unsupported telnet option:");
                 DEBUG_TELNET.println(str.opt0, HEX);
     #endif
-                _clientStr.clientState = Normal;
+                str.clientState = Normal;
                 return true;
             }
             default:
@@ -130,27 +342,71 @@ bool SimpleTelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
     {
         switch (str.opt1)
         {
-            // extend for RFC 1079 - TELNET TERMINAL SPEED OPTION, also needed
-            // to add subnegotiation support for this.
+            // the client's terminal, RFC 1079, 1091, 1073 and 1572.  We
+            // ask the client for these, the one thing we answer is our
+            // own terminal speed, and that needed subnegotiation support.
             case TELNET_OPTION_TERMINAL_SPEED:
+            case TELNET_OPTION_TERMINAL_TYPE:
+            case TELNET_OPTION_NAWS:
+            case TELNET_OPTION_NEW_ENVIRON:
             {
+                byte bit = _capabilityBit(str.opt1);
+
                 if (str.opt0 == TELNET_WILL)
                 {
-                    str.buffer[str.bufferLen] = TELNET_IAC;
-                    str.bufferLen++;
-                    str.buffer[str.bufferLen] = TELNET_DO;
-                    str.bufferLen++;
-                    str.buffer[str.bufferLen] = str.opt1;
-                    str.bufferLen++;
+                    bool asked = (_terminal.optRequested & bit) != 0;
+                    _terminal.optRequested &= ~bit;
+
+                    if (!(_terminal.optEnabled & bit))
+                    {
+                        // a WILL answering our DO needs no reply
+                        if (!asked)
+                        {
+                            str.buffer[str.bufferLen++] = TELNET_IAC;
+                            str.buffer[str.bufferLen++] = TELNET_DO;
+                            str.buffer[str.bufferLen++] = str.opt1;
+                        }
+
+                        _terminal.optEnabled |= bit;
+
+                        // NAWS sends its window size unasked
+                        if (str.opt1 != TELNET_OPTION_NAWS)
+                            _requestSubNegotiation(str, str.opt1);
+                    }
+                }
+                else if (str.opt0 == TELNET_WONT)
+                {
+                    _terminal.optRequested &= ~bit;
+
+                    if (_terminal.optEnabled & bit)
+                    {
+                        str.buffer[str.bufferLen++] = TELNET_IAC;
+                        str.buffer[str.bufferLen++] = TELNET_DONT;
+                        str.buffer[str.bufferLen++] = str.opt1;
+                        _terminal.optEnabled &= ~bit;
+                    }
+
+                    // whatever the cache said, this client won't
+                    if (str.opt1 == TELNET_OPTION_NAWS && (_terminal.optPresumed & bit))
+                        _terminal.cols = _terminal.rows = 0;
+                    if (str.opt1 != TELNET_OPTION_TERMINAL_TYPE)
+                        _terminal.optPresumed &= ~bit;
+
+                    if (str.opt1 == TELNET_OPTION_TERMINAL_TYPE)
+                        _identify(client, str, "");
+                    else
+                        _storeCapabilities(client, str);
+                }
+                else if (str.opt0 == TELNET_DO && str.opt1 == TELNET_OPTION_TERMINAL_SPEED)
+                {
+                    str.buffer[str.bufferLen++] = TELNET_IAC;
+                    str.buffer[str.bufferLen++] = TELNET_WILL;
+                    str.buffer[str.bufferLen++] = str.opt1;
                 }
-                else if (_clientStr.opt0 == TELNET_DO)
+                else
                 {
-                    str.buffer[str.bufferLen] = TELNET_IAC;
-                    str.bufferLen++;
-                    str.buffer[str.bufferLen] = TELNET_WILL;
-                    str.bufferLen++;
-                    str.buffer[str.bufferLen] = str.opt1;
-                    str.bufferLen++;
+                    // let the base class refuse it
+                    return false;
                 }
 
                 str.clientState = Normal;
@@ -167,6 +423,12 @@ bool SimpleTelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
     return false;
 }
 
+bool SimpleTelnetServer::_canReceive(struct ClientStruct &str)
+{
+    // a line being discarded takes no room
+    return _discarding || recvBufLen < recvBufSize;
+}
+
 bool SimpleTelnetServer::_processSubNegotiation(WiFiClient &client, struct ClientStruct &str)
 {
     // we have captured a sb block:
@@ -174,22 +436,23 @@ bool SimpleTelnetServer::_processSubNegotiation(WiFiClient &client, struct Clien
     if (TelnetServer::_processSubNegotiation(client, str))
         return true;
 
+    if (str.negoBufferLen < 2)
+        return false;
+
     switch (str.negoBuffer[0])
     {
         case TELNET_OPTION_TERMINAL_SPEED:
         {
-            int txSpeed = 9600;
-            int rxSpeed = 9600;
-
-            if (str.negoBuffer[1] == 1)
+            if (str.negoBuffer[1] == TELNET_SB_SEND)
             {
                 str.buffer[str.bufferLen++] = TELNET_IAC;
                 str.buffer[str.bufferLen++] = TELNET_SB;
                 str.buffer[str.bufferLen++] = TELNET_OPTION_TERMINAL_SPEED;
-                str.buffer[str.bufferLen++] = 0;
-                str.bufferLen += sprintf((char*)&str.buffer[str.bufferLen], "%d,%d", txSpeed, rxSpeed);
+                str.buffer[str.bufferLen++] = TELNET_SB_IS;
+                str.bufferLen += snprintf((char*)&str.buffer[str.bufferLen], str.bufferSize - str.bufferLen - 2,
+                                          "%lu,%lu", _txSpeed, _rxSpeed);
                 str.buffer[str.bufferLen++] = TELNET_IAC;
-                str.buffer[str.bufferLen] = TELNET_SE;
+                str.buffer[str.bufferLen++] = TELNET_SE;
 
     #ifdef DEBUG_TELNET
                 DEBUG_TELNET.println("SB TERMINAL SPEED");
@@ -204,6 +467,71 @@ bool SimpleTelnetServer::_processSubNegotiation(WiFiClient &client, struct Clien
                 return true;
             }
 
+            if (str.negoBuffer[1] == TELNET_SB_IS)
+            {
+                // "<tx>,<rx>" in ascii
+                char speeds[24];
+                TelnetIndex len = str.negoBufferLen - 2;
+                if (len >= sizeof(speeds))
+                    len = sizeof(speeds) - 1;
+                memcpy(speeds, &str.negoBuffer[2], len);
+                speeds[len] = 0;
+
+                char *rx;
+                _terminal.txSpeed = strtoul(speeds, &rx, 10);
+                _terminal.rxSpeed = (*rx == ',') ? strtoul(rx + 1, NULL, 10) : _terminal.txSpeed;
+
+                _storeCapabilities(client, str);
+                return true;
+            }
+
+            break;
+        }
+
+        case TELNET_OPTION_TERMINAL_TYPE:
+        {
+            if (str.negoBuffer[1] == TELNET_SB_IS)
+            {
+                char termType[TELNET_TTYPE_SIZE];
+                TelnetIndex len = str.negoBufferLen - 2;
+                if (len >= sizeof(termType))
+                    len = sizeof(termType) - 1;
+                memcpy(termType, &str.negoBuffer[2], len);
+                termType[len] = 0;
+
+                _identify(client, str, termType);
+                return true;
+            }
+
+            break;
+        }
+
+        case TELNET_OPTION_NAWS:
+        {
+            // width and height, 16 bits each, network order
+            if (str.negoBufferLen >= 5)
+            {
+                _terminal.cols = (str.negoBuffer[1] << 8) | str.negoBuffer[2];
+                _terminal.rows = (str.negoBuffer[3] << 8) | str.negoBuffer[4];
+                _terminal.sizeKnown = 1;
+                _terminal.optPresumed &= ~TELNET_CAP_NAWS;
+
+                _storeCapabilities(client, str);
+                return true;
+            }
+
+            break;
+        }
+
+        case TELNET_OPTION_NEW_ENVIRON:
+        {
+            if (str.negoBuffer[1] == TELNET_SB_IS || str.negoBuffer[1] == TELNET_SB_INFO)
+            {
+                _parseEnviron(str);
+                _storeCapabilities(client, str);
+                return true;
+            }
+
             break;
         }
 
@@ -213,3 +541,216 @@ bool SimpleTelnetServer::_processSubNegotiation(WiFiClient &client, struct Clien
 
     return false;
 }
+
+void SimpleTelnetServer::_processConnect(WiFiClient &client, struct ClientStruct &str)
+{
+    // nothing the last client sent may reach this one's reader
+    recvBufLen = 0;
+    _lineLen = 0;
+    _discarding = false;
+
+    // nor what we knew of its terminal
+    memset(&_terminal, 0, sizeof(_terminal));
+
+    if (_passive)
+        return;
+
+    byte wanted = TELNET_CAP_ALL;
+
+    if (_capabilityCache != NULL)
+    {
+        const TelnetCapabilities *caps = _capabilityCache->find(client.remoteIP());
+        if (caps != NULL)
+            wanted = _applyCapabilities(str, *caps);
+    }
+
+    _requestOptions(str, wanted);
+}
+
+void SimpleTelnetServer::_processEnviron(struct ClientStruct &str, const char *name, const char *value)
+{
+    if (strcmp(name, "USER") == 0)
+    {
+        strncpy(_terminal.user, value, TELNET_USER_SIZE - 1);
+        _terminal.user[TELNET_USER_SIZE - 1] = 0;
+    }
+}
+
+byte SimpleTelnetServer::_capabilityBit(byte option)
+{
+    switch (option)
+    {
+        case TELNET_OPTION_TERMINAL_TYPE:   return TELNET_CAP_TTYPE;
+        case TELNET_OPTION_NAWS:            return TELNET_CAP_NAWS;
+        case TELNET_OPTION_TERMINAL_SPEED:  return TELNET_CAP_TSPEED;
+        case TELNET_OPTION_NEW_ENVIRON:     return TELNET_CAP_NEW_ENVIRON;
+        default:                            return 0;
+    }
+}
+
+void SimpleTelnetServer::_requestOptions(struct ClientStruct &str, byte caps)
+{
+    static const byte options[] =
+    {
+        TELNET_OPTION_TERMINAL_TYPE,
+        TELNET_OPTION_NAWS,
+        TELNET_OPTION_TERMINAL_SPEED,
+        TELNET_OPTION_NEW_ENVIRON
+    };
+
+    for (uint8_t i = 0; i < sizeof(options); i++)
+    {
+        byte bit = _capabilityBit(options[i]);
+
+        if (!(caps & bit) || ((_terminal.optRequested | _terminal.optEnabled) & bit))
+            continue;
+
+        str.buffer[str.bufferLen++] = TELNET_IAC;
+        str.buffer[str.bufferLen++] = TELNET_DO;
+        str.buffer[str.bufferLen++] = options[i];
+        _terminal.optRequested |= bit;
+    }
+}
+
+void SimpleTelnetServer::_requestSubNegotiation(struct ClientStruct &str, byte option)
+{
+    str.buffer[str.bufferLen++] = TELNET_IAC;
+    str.buffer[str.bufferLen++] = TELNET_SB;
+    str.buffer[str.bufferLen++] = option;
+    str.buffer[str.bufferLen++] = TELNET_SB_SEND;
+    str.buffer[str.bufferLen++] = TELNET_IAC;
+    str.buffer[str.bufferLen++] = TELNET_SE;
+}
+
+byte SimpleTelnetServer::_applyCapabilities(struct ClientStruct &str, const TelnetCapabilities &caps)
+{
+    strcpy(_terminal.termType, caps.termType);
+    _terminal.txSpeed = caps.txSpeed;
+    _terminal.rxSpeed = caps.rxSpeed;
+
+    if (!_terminal.sizeKnown)
+    {
+        _terminal.cols = caps.cols;
+        _terminal.rows = caps.rows;
+    }
+
+    // take the profile as it was, so the session can start on it right
+    // away (see terminalReady()) rather than a round trip later.  The
+    // terminal type and window size are still asked in the background:
+    // another terminal type replaces the profile, see _identify(), a
+    // new window size overwrites it.  The line speed is not asked
+    // again, the environment always is, USER may be someone else.
+    _terminal.optPresumed = TELNET_CAP_TTYPE | (caps.options & (TELNET_CAP_NAWS | TELNET_CAP_TSPEED));
+
+    return TELNET_CAP_TTYPE | (caps.options & (TELNET_CAP_NAWS | TELNET_CAP_NEW_ENVIRON));
+}
+
+void SimpleTelnetServer::_identify(WiFiClient &client, struct ClientStruct &str, const char *termType)
+{
+    bool presumedOther = (_terminal.optPresumed & TELNET_CAP_TTYPE) && strcasecmp(_terminal.termType, termType) != 0;
+
+    strncpy(_terminal.termType, termType, TELNET_TTYPE_SIZE - 1);
+    _terminal.termType[TELNET_TTYPE_SIZE - 1] = 0;
+    _terminal.termKnown = 1;
+    _terminal.optPresumed &= ~TELNET_CAP_TTYPE;
+
+    if (presumedOther)
+    {
+        // the profile we started with belongs to another terminal on
+        // the same host, use its own if we have it, else ask for it all.
+        const TelnetCapabilities *caps = NULL;
+        if (_capabilityCache != NULL)
+            caps = _capabilityCache->find(client.remoteIP(), _terminal.termType);
+
+        byte wanted = TELNET_CAP_ALL;
+
+        if (caps != NULL)
+            wanted = _applyCapabilities(str, *caps);
+        else
+        {
+            if (_terminal.optPresumed & TELNET_CAP_TSPEED)
+                _terminal.txSpeed = _terminal.rxSpeed = 0;
+            if (_terminal.optPresumed & TELNET_CAP_NAWS)
+                _terminal.cols = _terminal.rows = 0;
+
+            _terminal.optPresumed = 0;
+        }
+
+        // the type is settled, it need not be presumed again
+        _terminal.optPresumed &= ~TELNET_CAP_TTYPE;
+
+        _requestOptions(str, wanted);
+    }
+
+    _storeCapabilities(client, str);
+}
+
+void SimpleTelnetServer::_storeCapabilities(WiFiClient &client, struct ClientStruct &str)
+{
+    // until the terminal type is settled we don't know who this is
+    if (_capabilityCache == NULL || !_terminal.termKnown)
+        return;
+
+    TelnetCapabilities caps;
+
+    caps.addr = client.remoteIP();
+    strcpy(caps.termType, _terminal.termType);
+    caps.options = _terminal.optEnabled | _terminal.optPresumed;
+    caps.cols = _terminal.cols;
+    caps.rows = _terminal.rows;
+    caps.txSpeed = _terminal.txSpeed;
+    caps.rxSpeed = _terminal.rxSpeed;
+
+    _capabilityCache->store(caps);
+}
+
+/*
+    copies a NEW-ENVIRON name or value starting at i into dst, up to the
+    next unescaped marker, returns the index of that marker.
+*/
+static TelnetIndex _environString(const uint8_t *buf, TelnetIndex len, TelnetIndex i, char *dst, size_t size)
+{
+    size_t n = 0;
+
+    while (i < len)
+    {
+        uint8_t c = buf[i];
+
+        if (c == TELNET_ENVIRON_VAR || c == TELNET_ENVIRON_VALUE || c == TELNET_ENVIRON_USERVAR)
+            break;
+
+        if (c == TELNET_ENVIRON_ESC && i + 1 < len)
+            c = buf[++i];
+
+        if (n < size - 1)
+            dst[n++] = c;
+
+        i++;
+    }
+
+    dst[n] = 0;
+    return i;
+}
+
+void SimpleTelnetServer::_parseEnviron(struct ClientStruct &str)
+{
+    // NEW-ENVIRON IS|INFO [ VAR|USERVAR name [ VALUE value ] ] ...
+    char name[16];
+    char value[32];
+    TelnetIndex i = 2;
+
+    while (i < str.negoBufferLen)
+    {
+        uint8_t type = str.negoBuffer[i++];
+        if (type != TELNET_ENVIRON_VAR && type != TELNET_ENVIRON_USERVAR)
+            break;
+
+        i = _environString(str.negoBuffer, str.negoBufferLen, i, name, sizeof(name));
+
+        value[0] = 0;
+        if (i < str.negoBufferLen && str.negoBuffer[i] == TELNET_ENVIRON_VALUE)
+            i = _environString(str.negoBuffer, str.negoBufferLen, i + 1, value, sizeof(value));
+
+        _processEnviron(str, name, value);
+    }
+}
@@ -20,7 +20,10 @@
 
     RFC 857 - TELNET ECHO OPTION
     RFC 858 - TELNET SUPPRESS GO AHEAD OPTION
+    RFC 1073 - TELNET WINDOW SIZE OPTION
     RFC 1079 - TELNET TERMINAL SPEED OPTION
+    RFC 1091 - TELNET TERMINAL-TYPE OPTION
+    RFC 1572 - TELNET ENVIRONMENT OPTION
 */
 
 
@@ -35,9 +38,30 @@
 #endif
 
 #include "Telnet.h"
+#include "TelnetCapabilityCache.h"
 
 // telnet options
+#define TELNET_OPTION_TERMINAL_TYPE     24
+#define TELNET_OPTION_NAWS              31
 #define TELNET_OPTION_TERMINAL_SPEED    32
+#define TELNET_OPTION_NEW_ENVIRON       39
+
+// subnegotiation commands, shared by TTYPE, TSPEED and NEW-ENVIRON
+#define TELNET_SB_IS                    0
+#define TELNET_SB_SEND                  1
+#define TELNET_SB_INFO                  2
+
+// NEW-ENVIRON variable markers
+#define TELNET_ENVIRON_VAR              0
+#define TELNET_ENVIRON_VALUE            1
+#define TELNET_ENVIRON_ESC              2
+#define TELNET_ENVIRON_USERVAR          3
+
+// bytes kept of the client's user name, with the NUL
+#define TELNET_USER_SIZE                16
+
+// recvBuffer size of a SimpleTelnetServer, see SizedTelnetServer<>
+#define TELNET_RECV_BUFFER_SIZE         1024
 
 // Future work
 //#define TELNET_OPTION_COM_PORT          44
@@ -59,22 +83,199 @@
 #define TELNET_COM_PORT_PURGE               "12"
 */
 
-class SimpleTelnetServer : public TelnetServer
+class SimpleTelnetServer : public TelnetServer, public Print
 {
 public:
 
     SimpleTelnetServer();
 
+    SimpleTelnetServer(int port);
+
     virtual ~SimpleTelnetServer();
 
-    uint8_t recvBuffer[1024];
-    uint8_t recvBufLen;
+    uint8_t    *recvBuffer;
+    TelnetIndex recvBufLen;
+    TelnetIndex recvBufSize;
+
+    /*
+        Returns the next complete line held in recvBuffer, terminated in
+        place (no copy), or NULL if no full line has arrived yet.  CR, LF
+        and NUL all end a line and empty lines are skipped.  The returned
+        line is valid until the next call, which discards it from recvBuffer.
+        A line that overflows recvBuffer is dropped whole, everything
+        up to its line end, so its tail never shows up as a line.
+
+        readLine() keeps track of the line it handed out, so once a sketch
+        reads lines it must leave recvBuffer and recvBufLen alone; use
+        either readLine() or the raw buffer on a server, never both.
+    */
+    char *readLine();
+
+    /*
+        Print interface, queues bytes to the connected client, escaping
+        any 0xff as IAC IAC.  Output goes out with the next handleClient().
+    */
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buf, size_t size);
+    using Print::write;
+
+    /*
+        true when size more bytes fit in the outbound buffer without
+        forcing a flush to the client, or when it is empty anyway.
+    */
+    bool writeReady(size_t size);
+
+    /*
+        what the connected client told us about its terminal, or
+        what it told us last time when taken from the cache.  user()
+        is never cached, it is always what this session sent.
+    */
+    const char *terminalType();
+    const char *user();
+    uint16_t windowWidth();
+    uint16_t windowHeight();
+
+    /*
+        true once terminalType() and the window size can be relied on.
+        A returning client is ready as it connects, its profile taken
+        from the capability cache and confirmed in the background, a new
+        one after a round trip or two.  user() may come in later still.
+    */
+    bool terminalReady();
+
+    /*
+        the speeds we answer a client's TERMINAL-SPEED SEND with
+    */
+    void setTerminalSpeed(unsigned long txSpeed, unsigned long rxSpeed);
+
+    /*
+        remember each client's terminal in cache, so when it comes back
+        only what may have changed is negotiated.  Servers may share one.
+    */
+    void setCapabilityCache(TelnetCapabilityCache *cache);
 
 protected:
 
+    /*
+        uses recvStorage as recvBuffer, see SizedTelnetServer<>
+    */
+    SimpleTelnetServer(int port, uint8_t *recvStorage, TelnetIndex recvSize);
+
+    // length of the line last returned by readLine(), including its terminator
+    TelnetIndex _lineLen;
+
+    // true while the rest of an overlong line is being thrown away
+    bool _discarding;
+
+    // true when recvBuffer was allocated by our constructor
+    bool _ownsRecvBuffer;
+
+    /*
+        the connected client's terminal.  Kept here rather than in the
+        ClientStruct, a server has one client at a time and plain
+        TelnetServers and their sessions need none of it.
+    */
+    struct TerminalStruct
+    {
+        // optRequested are DO's awaiting an answer, optEnabled what the
+        // client agreed to, optPresumed what we took from a capability
+        // cache instead.  termKnown once the client sent its terminal
+        // type or refused to, sizeKnown once it sent its window size.
+        byte            optRequested;
+        byte            optEnabled;
+        byte            optPresumed;
+        byte            termKnown;
+        byte            sizeKnown;
+        char            termType[TELNET_TTYPE_SIZE];
+        char            user[TELNET_USER_SIZE];
+        uint16_t        cols;
+        uint16_t        rows;
+        unsigned long   txSpeed;
+        unsigned long   rxSpeed;
+    };
+
+    struct TerminalStruct _terminal;
+
     virtual bool _processSubNegotiation(WiFiClient &client, struct ClientStruct &str);
 
     virtual bool _processOption(WiFiClient &client, struct ClientStruct &str);
+
+    // false while recvBuffer is full, the rest waits in the socket
+    virtual bool _canReceive(struct ClientStruct &str);
+
+    /*
+        empties recvBuffer for the new client, then asks it for its
+        terminal, or for as little as the capability cache says we
+        need.  A passive server asks nothing.
+    */
+    virtual void _processConnect(WiFiClient &client, struct ClientStruct &str);
+
+    /*
+        one NEW-ENVIRON variable from the client, USER is kept in _terminal.user
+    */
+    virtual void _processEnviron(struct ClientStruct &str, const char *name, const char *value);
+
+    // the TELNET_CAP_ bit of option, or 0
+    static byte _capabilityBit(byte option);
+
+    // queues a DO for every option in caps we have not asked for yet
+    void _requestOptions(struct ClientStruct &str, byte caps);
+
+    // queues IAC SB option SEND IAC SE
+    static void _requestSubNegotiation(struct ClientStruct &str, byte option);
+
+    // takes over a cached profile, returns the options still to negotiate
+    byte _applyCapabilities(struct ClientStruct &str, const TelnetCapabilities &caps);
+
+    // the client told us its terminal type, "" when it won't
+    void _identify(WiFiClient &client, struct ClientStruct &str, const char *termType);
+
+    // saves the client's profile once we know who it is
+    void _storeCapabilities(WiFiClient &client, struct ClientStruct &str);
+
+    void _parseEnviron(struct ClientStruct &str);
+
+    TelnetCapabilityCache *_capabilityCache;
+
+    unsigned long _txSpeed;
+    unsigned long _rxSpeed;
+};
+
+/*
+    A SimpleTelnetServer with a RecvSize byte recvBuffer of its own rather
+    than an allocated TELNET_RECV_BUFFER_SIZE one.  Pair it with a
+    TelnetServer::ClientBuffers<> passed to begin(), or a manager's pool:
+
+        SizedTelnetServer<64> control(23);
+        TelnetServer::ClientBuffers<32, 64> controlClient;
+
+        control.begin(controlClient);
+
+    footprint() is what the instance costs, not counting its client.
+*/
+template <size_t RecvSize>
+class SizedTelnetServer : public SimpleTelnetServer
+{
+    static_assert(RecvSize <= (TelnetIndex)-1, "TelnetIndex cannot address RecvSize");
+    static_assert(RecvSize >= 2, "RecvSize must hold a character and its line end");
+
+public:
+
+    SizedTelnetServer() :
+        SimpleTelnetServer(23, _recvStorage, RecvSize)
+    {
+    }
+
+    SizedTelnetServer(int port) :
+        SimpleTelnetServer(port, _recvStorage, RecvSize)
+    {
+    }
+
+    static constexpr size_t footprint() { return sizeof(SizedTelnetServer); }
+
+protected:
+
+    uint8_t _recvStorage[RecvSize];
 };
 
 #endif
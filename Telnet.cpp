@@ -24,17 +24,34 @@
 */
 
 #include "Telnet.h"
+#include "TelnetServerManager.h"
 
 //#define DEBUG_TELNET  Serial
 
 TelnetServer::TelnetServer(int port) :
-    _server(port)
+    _server(port),
+    _session(0),
+    _manager(NULL),
+    _clientStr(NULL),
+    _ownsClientStr(false),
+    _passive(false)
 {
+#ifdef TELNET_TLS
+    _handshakeTime = 0;
+#endif
 }
 
 TelnetServer::TelnetServer() :
-    _server(23)
+    _server(23),
+    _session(0),
+    _manager(NULL),
+    _clientStr(NULL),
+    _ownsClientStr(false),
+    _passive(false)
 {
+#ifdef TELNET_TLS
+    _handshakeTime = 0;
+#endif
 }
 
 TelnetServer::~TelnetServer()
@@ -48,14 +65,41 @@ void TelnetServer::begin()
     DEBUG_TELNET.println("Telnet server started");
 #endif
 
+    // a managed server borrows its client struct from the manager's
+    // pool for the life of each session, otherwise we keep our own.
+    if (_manager == NULL && _clientStr == NULL)
+    {
+        _clientStr = new DefaultClientBuffers;
+        _ownsClientStr = true;
+    }
+
     _server.begin();
 }
 
+void TelnetServer::_begin(ClientStruct &str)
+{
+    if (_manager == NULL && _clientStr == NULL)
+        _clientStr = &str;
+
+    begin();
+}
+
 void TelnetServer::end()
 {
     if (_client)
         _client.stop();
 
+    _releaseClientStr();
+
+    if (_manager == NULL && _clientStr != NULL)
+    {
+        if (_ownsClientStr)
+            delete static_cast<DefaultClientBuffers *>(_clientStr);
+
+        _clientStr = NULL;
+        _ownsClientStr = false;
+    }
+
     _server.close();
 }
 
@@ -68,23 +112,52 @@ void TelnetServer::handleClient()
     // new client?
     if (_server.hasClient())
     {
-        if (_client)
+        if (_client || !_acquireClientStr())
         {
-            // already have one, sorry
+            // already have one, or the manager is out of sessions, sorry
 #ifdef DEBUG_TELNET
             DEBUG_TELNET.println("Rejecting client");
 #endif
-            WiFiClient rejectClient = _server.available();
+            // the plain accept, no point in a TLS handshake just to hang up
+            WiFiClient rejectClient = static_cast<WiFiServer &>(_server).available();
             rejectClient.stop();
         }
         else
         {
-            // grab the new client
+            // grab the new client, with TLS this runs the handshake
+#ifdef TELNET_TLS
+            unsigned long start = millis();
             _client = _server.available();
-            _initClient(_clientStr);
+            _handshakeTime = millis() - start;
+#else
+            _client = _server.available();
+#endif
+            if (!_client)
+            {
+                // gone before we got it, or the handshake failed.  Hand
+                // the session back, there is nothing to start.
+#ifdef DEBUG_TELNET
+                DEBUG_TELNET.println("Accept failed");
+#endif
+                _releaseClientStr();
+            }
+            else
+            {
+                _initClient(*_clientStr);
+                _session++;
+
+                // we coalesce output ourselves, see _updateRtt()
+                _client.setNoDelay(true);
+
+                _processConnect(_client, *_clientStr);
 #ifdef DEBUG_TELNET
-            DEBUG_TELNET.println("Accepted new client");
+                DEBUG_TELNET.println("Accepted new client");
+#ifdef TELNET_TLS
+                DEBUG_TELNET.print("TLS handshake ms: ");
+                DEBUG_TELNET.println(_handshakeTime);
 #endif
+#endif
+            }
         }
     }
 
@@ -98,37 +171,46 @@ void TelnetServer::handleClient()
             DEBUG_TELNET.println("Existing client stopped");
 #endif
             _client.stop();
+            _releaseClientStr();
             return;
         }
 
-        // at this point, we have a client and it is connected
-        while (_client.available())
+        struct ClientStruct &str = *_clientStr;
+
+        // at this point, we have a client and it is connected.  What
+        // the receiver has no room for stays with TCP, so the sender is
+        // slowed down rather than its data dropped.
+        while (_client.available() && _canReceive(str))
         {
-            char c = _client.read();
+            // make sure whatever reply this byte causes will fit
+            if (str.bufferLen + TELNET_BUFFER_HEADROOM > str.bufferSize)
+                _flush(_client, str);
+
+            uint8_t c = _client.read();
 #ifdef DEBUG_TELNET
             DEBUG_TELNET.print(c, HEX);
             DEBUG_TELNET.print(" ");
 #endif
-            switch (_clientStr.clientState)
+            switch (str.clientState)
             {
                 case Normal:
                 {
                     // don't pass this to sub-classes, just advance state
                     if (c == TELNET_IAC)
                     {
-                        _clientStr.clientState = InTelnetOpt0;
-                        return;
+                        str.clientState = InTelnetOpt0;
+                        continue;
                     }
 
-                    _clientStr.opt0 = c;
-                    _processOption(_client, _clientStr);
-                    return;
+                    str.opt0 = c;
+                    _processOption(_client, str);
+                    continue;
                 }
 
                 // Control
                 case InTelnetOpt0:
                 {
-                    _clientStr.opt0 = c;
+                    str.opt0 = c;
                     switch (c)
                     {
                         // don't pass this to sub-classes, just advance state
@@ -137,25 +219,25 @@ void TelnetServer::handleClient()
                         case TELNET_WONT:
                         case TELNET_DONT:
                         {
-                            _clientStr.clientState = InTelnetOpt1;
-                            return;
+                            str.clientState = InTelnetOpt1;
+                            continue;
                         }
 
                         case TELNET_IAC:
                         {
                             // this is an escaped 0xff, go back to normal mode
                             // and send to sub-classes as just a normal 0xff char
-                            _clientStr.clientState = Normal;
-                            _clientStr.opt0 = c;
-                            _processOption(_client, _clientStr);
-                            return;
+                            str.clientState = Normal;
+                            str.opt0 = c;
+                            _processOption(_client, str);
+                            continue;
                         }
                         case TELNET_SB: // start of sub-nego
                         {
                             // don't pass this to sub-classes, just advance state
-                            _clientStr.clientState = InTelnetSubNego0;
-                            _clientStr.negoBufferLen = 0;
-                            return;
+                            str.clientState = InTelnetSubNego0;
+                            str.negoBufferLen = 0;
+                            continue;
                         }
 
                         default:
@@ -163,9 +245,9 @@ void TelnetServer::handleClient()
                             // got one of these really, really old IAC commands
                             // for EL, EC, GA, etc, pass to client.  Regardless
                             // change back to normal mode.
-                            _processOption(_client, _clientStr);
-                            _clientStr.clientState = Normal;
-                            return;
+                            _processOption(_client, str);
+                            str.clientState = Normal;
+                            continue;
                         }
                     }
                 }
@@ -173,38 +255,38 @@ void TelnetServer::handleClient()
                 // Option
                 case InTelnetOpt1:
                 {
-                    _clientStr.opt1 = c;
+                    str.opt1 = c;
 
                     // here, we let the sub-class determine handling of TELNET options
                     // If it handles it, we are done, otherwise we send appropriate DONT
                     // WONT.  And back to normal mode.
-                    if (_processOption(_client, _clientStr))
+                    if (_processOption(_client, str))
                     {
-                        _clientStr.clientState = Normal;
-                        return;
+                        str.clientState = Normal;
+                        continue;
                     }
 
                     // default handling for unhandled requests
-                    if (_clientStr.opt0 == TELNET_WILL)
+                    if (str.opt0 == TELNET_WILL)
                     {
                         // send DONT
-                        _clientStr.buffer[_clientStr.bufferLen] = TELNET_IAC;
-                        _clientStr.bufferLen++;
-                        _clientStr.buffer[_clientStr.bufferLen] = TELNET_DONT;
-                        _clientStr.bufferLen++;
-                        _clientStr.buffer[_clientStr.bufferLen] = c;
-                        _clientStr.bufferLen++;
+                        str.buffer[str.bufferLen] = TELNET_IAC;
+                        str.bufferLen++;
+                        str.buffer[str.bufferLen] = TELNET_DONT;
+                        str.bufferLen++;
+                        str.buffer[str.bufferLen] = c;
+                        str.bufferLen++;
 
                     }
-                    else if (_clientStr.opt0 == TELNET_DO)
+                    else if (str.opt0 == TELNET_DO)
                     {
                         // send WONT
-                        _clientStr.buffer[_clientStr.bufferLen] = TELNET_IAC;
-                        _clientStr.bufferLen++;
-                        _clientStr.buffer[_clientStr.bufferLen] = TELNET_WONT;
-                        _clientStr.bufferLen++;
-                        _clientStr.buffer[_clientStr.bufferLen] = c;
-                        _clientStr.bufferLen++;
+                        str.buffer[str.bufferLen] = TELNET_IAC;
+                        str.bufferLen++;
+                        str.buffer[str.bufferLen] = TELNET_WONT;
+                        str.bufferLen++;
+                        str.buffer[str.bufferLen] = c;
+                        str.bufferLen++;
                     }
                     else
                     {
@@ -214,8 +296,8 @@ void TelnetServer::handleClient()
 #endif
                     }
 
-                    _clientStr.clientState = Normal;
-                    return;
+                    str.clientState = Normal;
+                    continue;
                 }
 
                 // Sub Negoiations
@@ -224,11 +306,11 @@ void TelnetServer::handleClient()
                     // In order to handle an embedded 0xff in subnegotiation mode,
                     // we get an extra state, InTelnetSubNego1.
                     if (c == TELNET_IAC)
-                        _clientStr.clientState = InTelnetSubNego1;
-                    else
+                        str.clientState = InTelnetSubNego1;
+                    else if (str.negoBufferLen < str.negoBufferSize)
                     {
-                        _clientStr.negoBuffer[_clientStr.negoBufferLen] = c;
-                        _clientStr.negoBufferLen++;
+                        str.negoBuffer[str.negoBufferLen] = c;
+                        str.negoBufferLen++;
                     }
                     break;
                 }
@@ -240,15 +322,18 @@ void TelnetServer::handleClient()
                     if (c == TELNET_IAC)
                     {
                         // they sent an esc'd 0xff, back to InTelnetSubNego0
-                        _clientStr.clientState = InTelnetSubNego0;
-                        _clientStr.negoBuffer[_clientStr.negoBufferLen] = TELNET_IAC;
-                        _clientStr.negoBufferLen++;
+                        str.clientState = InTelnetSubNego0;
+                        if (str.negoBufferLen < str.negoBufferSize)
+                        {
+                            str.negoBuffer[str.negoBufferLen] = TELNET_IAC;
+                            str.negoBufferLen++;
+                        }
                     }
                     else if (c == TELNET_SE)
                     {
                         // we got the completed subnegotiation, process it
-                        _processSubNegotiation(_client, _clientStr);
-                        _clientStr.clientState = Normal;
+                        _processSubNegotiation(_client, str);
+                        str.clientState = Normal;
                     }
                     else
                     {
@@ -264,28 +349,85 @@ void TelnetServer::handleClient()
             }
         }
 
-        // Send outbound data
-        if (_clientStr.bufferLen > 0)
+        unsigned long now = millis();
+
+        // time to measure the round trip again?  Not while the last
+        // probe is unanswered, its reply would be taken for this one's.
+        if (!_passive && !str.tmPending && now - str.tmSent >= TELNET_TM_PROBE_INTERVAL)
         {
-#ifdef DEBUG_TELNET
-            DEBUG_TELNET.println("");
-            DEBUG_TELNET.print("Sending bytes: ");
-            DEBUG_TELNET.println(_clientStr.bufferLen);
+            if (str.bufferLen + TELNET_BUFFER_HEADROOM > str.bufferSize)
+                _flush(_client, str);
+
+            str.buffer[str.bufferLen++] = TELNET_IAC;
+            str.buffer[str.bufferLen++] = TELNET_DO;
+            str.buffer[str.bufferLen++] = TELNET_OPTION_TIMING_MARK;
+            str.tmPending = 1;
+            str.tmSent = now;
+
+            // don't let coalescing skew the measurement
+            _flush(_client, str);
+        }
 
-            for (auto i = 0; i < _clientStr.bufferLen; i++)
+        // Send outbound data, once it has been held for flushDelay
+        if (str.bufferLen > 0)
+        {
+            if (!str.holding)
             {
-                DEBUG_TELNET.print(_clientStr.buffer[i], HEX);
-                DEBUG_TELNET.print(" ");
+                str.holding = 1;
+                str.heldSince = now;
             }
-            DEBUG_TELNET.println();
-#endif
 
-            _client.write(&_clientStr.buffer[0], _clientStr.bufferLen);
-            _clientStr.bufferLen = 0;
+            if (now - str.heldSince >= str.flushDelay)
+                _flush(_client, str);
         }
     }
 }
 
+#ifdef TELNET_TLS
+void TelnetServer::setRSACert(const BearSSL::X509List *chain, const BearSSL::PrivateKey *sk)
+{
+    _server.setRSACert(chain, sk);
+}
+
+void TelnetServer::setECCert(const BearSSL::X509List *chain, unsigned cert_issuer_key_type, const BearSSL::PrivateKey *sk)
+{
+    _server.setECCert(chain, cert_issuer_key_type, sk);
+}
+
+void TelnetServer::setCache(BearSSL::ServerSessions *cache)
+{
+    _server.setCache(cache);
+}
+
+unsigned long TelnetServer::handshakeTime()
+{
+    return _handshakeTime;
+}
+#endif
+
+bool TelnetServer::connected()
+{
+    return _client && _client.connected();
+}
+
+uint16_t TelnetServer::session()
+{
+    return _session;
+}
+
+void TelnetServer::setPassive(bool passive)
+{
+    _passive = passive;
+}
+
+uint16_t TelnetServer::rtt()
+{
+    if (!_client || _clientStr == NULL)
+        return 0;
+
+    return _clientStr->srtt;
+}
+
 void TelnetServer::_initClient(ClientStruct& str)
 {
     str.clientState = Normal;
@@ -295,6 +437,86 @@ void TelnetServer::_initClient(ClientStruct& str)
 
     str.opt0 = 0;
     str.opt1 = 0;
+
+    str.holding = 0;
+    str.heldSince = 0;
+    str.flushDelay = 0;
+
+    // makes the first probe go out right away
+    str.tmPending = 0;
+    str.tmSent = millis() - TELNET_TM_PROBE_INTERVAL;
+    str.srtt = 0;
+}
+
+bool TelnetServer::_acquireClientStr()
+{
+    if (_manager != NULL)
+        _clientStr = _manager->_acquireClientStr();
+
+    return _clientStr != NULL;
+}
+
+void TelnetServer::_releaseClientStr()
+{
+    // our own client struct is kept until end()
+    if (_manager == NULL || _clientStr == NULL)
+        return;
+
+    _manager->_releaseClientStr(_clientStr);
+    _clientStr = NULL;
+}
+
+void TelnetServer::_flush(WiFiClient& client, ClientStruct& str)
+{
+    if (str.bufferLen == 0)
+        return;
+
+#ifdef DEBUG_TELNET
+    DEBUG_TELNET.println("");
+    DEBUG_TELNET.print("Sending bytes: ");
+    DEBUG_TELNET.println(str.bufferLen);
+
+    for (auto i = 0; i < str.bufferLen; i++)
+    {
+        DEBUG_TELNET.print(str.buffer[i], HEX);
+        DEBUG_TELNET.print(" ");
+    }
+    DEBUG_TELNET.println();
+#endif
+
+    client.write(&str.buffer[0], str.bufferLen);
+    str.bufferLen = 0;
+    str.holding = 0;
+}
+
+void TelnetServer::_updateRtt(ClientStruct& str, unsigned long sample)
+{
+    if (sample > 0xffff)
+        sample = 0xffff;
+    if (sample == 0)
+        sample = 1;
+
+    // same smoothing as TCP, srtt = 7/8 srtt + 1/8 sample
+    if (str.srtt == 0)
+        str.srtt = sample;
+    else
+        str.srtt = ((unsigned long)str.srtt * 7 + sample) / 8;
+
+    // holding output for a quarter of the round trip is hardly
+    // noticed by the user, but saves a lot of small segments.
+    if (str.srtt < TELNET_TM_FAST_RTT)
+        str.flushDelay = 0;
+    else if (str.srtt / 4 > TELNET_TM_MAX_FLUSH_DELAY)
+        str.flushDelay = TELNET_TM_MAX_FLUSH_DELAY;
+    else
+        str.flushDelay = str.srtt / 4;
+
+#ifdef DEBUG_TELNET
+    DEBUG_TELNET.print("RTT ");
+    DEBUG_TELNET.print(sample);
+    DEBUG_TELNET.print(" srtt ");
+    DEBUG_TELNET.println(str.srtt);
+#endif
 }
 
 bool TelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
@@ -308,6 +530,38 @@ bool TelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
     {
         switch (str.opt1)
         {
+            // RFC 860, never actually enabled, a WILL/WONT answers our
+            // probe and a DO is the client probing us.
+            case TELNET_OPTION_TIMING_MARK:
+            {
+                if (str.opt0 == TELNET_WILL || str.opt0 == TELNET_WONT)
+                {
+                    if (str.tmPending)
+                    {
+                        str.tmPending = 0;
+                        _updateRtt(str, millis() - str.tmSent);
+                    }
+                    else if (str.opt0 == TELNET_WILL)
+                    {
+                        str.buffer[str.bufferLen++] = TELNET_IAC;
+                        str.buffer[str.bufferLen++] = TELNET_DONT;
+                        str.buffer[str.bufferLen++] = str.opt1;
+                    }
+                }
+                else if (str.opt0 == TELNET_DO)
+                {
+                    // everything before the mark has been processed,
+                    // so answer at once, past any coalescing.
+                    str.buffer[str.bufferLen++] = TELNET_IAC;
+                    str.buffer[str.bufferLen++] = TELNET_WILL;
+                    str.buffer[str.bufferLen++] = str.opt1;
+                    _flush(client, str);
+                }
+
+                str.clientState = Normal;
+                return true;
+            }
+
             case TELNET_OPTION_TRANSMIT_BINARY:
             case TELNET_OPTION_ECHO:
             case TELNET_OPTION_SUPPRESS_GA:
@@ -322,7 +576,7 @@ bool TelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
                     str.bufferLen++;
                 }
 
-                else if (_clientStr.opt0 == TELNET_DO)
+                else if (str.opt0 == TELNET_DO)
                 {
                     str.buffer[str.bufferLen] = TELNET_IAC;
                     str.bufferLen++;
@@ -358,6 +612,15 @@ bool TelnetServer::_processOption(WiFiClient& client, ClientStruct& str)
     return false;
 }
 
+bool TelnetServer::_canReceive(struct ClientStruct &str)
+{
+    return true;
+}
+
+void TelnetServer::_processConnect(WiFiClient &client, struct ClientStruct &str)
+{
+}
+
 bool TelnetServer::_processSubNegotiation(WiFiClient &client, struct ClientStruct &str)
 {
     return false;
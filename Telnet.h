@@ -21,6 +21,7 @@
         RFC 854 - TELNET PROTOCOL SPEFICICATIONS
         RFC 855 - TELNET OPTION SPECIFICATIONS
         RFC 856 - TELNET BINARY TRANSMISSION
+        RFC 860 - TELNET TIMING MARK OPTION
 
     RFC 854 is the key spec, as it allows for extensible support, which
     is represented by two virtual functions that can be handled.
@@ -28,6 +29,9 @@
 
     This is a base class that receives incoming bytes from a WiFi client
     and decodes the protocol.   
+
+    With TELNET_TLS defined below, every server speaks TLS instead of
+    plain TCP, see setRSACert()/setECCert() and setCache().
 */
 
 #ifndef _TELNET_h
@@ -42,6 +46,21 @@
 #include <WiFiServer.h>
 #include <WiFiClient.h>
 
+// Uncomment to run the servers over TLS, this needs the BearSSL
+// WiFiServerSecure of the ESP8266 Arduino core 2.5 or later.
+//#define TELNET_TLS
+
+#ifdef TELNET_TLS
+    #include <WiFiServerSecureBearSSL.h>
+    #include <WiFiClientSecureBearSSL.h>
+
+    typedef BearSSL::WiFiServerSecure   TelnetWiFiServer;
+    typedef BearSSL::WiFiClientSecure   TelnetWiFiClient;
+#else
+    typedef WiFiServer                  TelnetWiFiServer;
+    typedef WiFiClient                  TelnetWiFiClient;
+#endif
+
 #define TELNET_SE   240
 #define TELNET_NOP  241
 #define TELNET_DM   242
@@ -63,9 +82,37 @@
 #define TELNET_OPTION_TRANSMIT_BINARY   0
 #define TELNET_OPTION_ECHO              1
 #define TELNET_OPTION_SUPPRESS_GA       3
+#define TELNET_OPTION_TIMING_MARK       6
+
+// buffer sizes of the client struct a standalone server allocates in begin()
+#define TELNET_NEGO_BUFFER_SIZE     128
+#define TELNET_BUFFER_SIZE          1024
+
+// outbound space kept free so one complete reply always fits
+#define TELNET_BUFFER_HEADROOM      32
+
+// width of every buffer length/index, buffers must fit in it
+#ifndef TELNET_INDEX_TYPE
+#define TELNET_INDEX_TYPE           uint16_t
+#endif
+
+typedef TELNET_INDEX_TYPE TelnetIndex;
+
+// ms between the TIMING-MARK probes we send to measure the round trip
+#define TELNET_TM_PROBE_INTERVAL    30000
+
+// ms, clients with a smoothed round trip below this get output at once
+#define TELNET_TM_FAST_RTT          20
+
+// ms, the longest outbound data (and echo) is held back to coalesce
+#define TELNET_TM_MAX_FLUSH_DELAY   40
+
+class TelnetServerManager;
 
 class TelnetServer
 {
+    friend class TelnetServerManager;
+
 public:
 
     void begin();
@@ -73,13 +120,51 @@ public:
 
     void handleClient();
 
-    virtual ~TelnetServer();
+    /*
+        smoothed round trip time to the client in ms, measured with
+        TIMING-MARK, 0 until the client answered a probe.
+    */
+    uint16_t rtt();
 
-protected:
+    // true while a client is connected
+    bool connected();
 
-    TelnetServer();
+    /*
+        changes with every client accepted, so a poller can tell a new
+        session from the one it saw last.
+    */
+    uint16_t session();
 
-    TelnetServer(int port);
+    /*
+        a passive server never starts a negotiation of its own, no
+        TIMING-MARK probes and no terminal queries, it only answers the
+        client.  For raw ports whose peer may not speak telnet at all.
+    */
+    void setPassive(bool passive);
+
+#ifdef TELNET_TLS
+    /*
+        the certificate chain and key we present, set before begin()
+    */
+    void setRSACert(const BearSSL::X509List *chain, const BearSSL::PrivateKey *sk);
+    void setECCert(const BearSSL::X509List *chain, unsigned cert_issuer_key_type, const BearSSL::PrivateKey *sk);
+
+    /*
+        a session cache lets a returning client resume its session with
+        a few symmetric operations rather than a full RSA/EC handshake,
+        several servers may share one.  See SizedTelnetSessionCache<>.
+    */
+    void setCache(BearSSL::ServerSessions *cache);
+
+    /*
+        ms the TLS handshake of the last accepted client took, resumed
+        sessions should come in well below full handshakes.  The same
+        comparison on the build host: extras/host/handshake_bench.cpp.
+    */
+    unsigned long handshakeTime();
+#endif
+
+    virtual ~TelnetServer();
 
     enum ClientState
     {
@@ -92,22 +177,101 @@ protected:
 
     // currently we only support one client, however,
     // should the need arise to support multiple clients
-    // each client should have one of these.
+    // each client should have one of these.  The buffers
+    // themselves live in a ClientBuffers<> below.
     struct ClientStruct
     {
+        // no buffers until a ClientBuffers<> provides them
+        ClientStruct() :
+            negoBuffer(NULL),
+            negoBufferSize(0),
+            negoBufferLen(0),
+            buffer(NULL),
+            bufferSize(0),
+            bufferLen(0)
+        {
+        }
+
         enum ClientState clientState;
         byte            opt0;
         byte            opt1;
         byte            echo;
         byte            noga;
 
-        uint8_t         negoBuffer[128];
-        uint8_t         negoBufferLen;
+        uint8_t        *negoBuffer;
+        TelnetIndex     negoBufferSize;
+        TelnetIndex     negoBufferLen;
+
+        uint8_t        *buffer;
+        TelnetIndex     bufferSize;
+        TelnetIndex     bufferLen;
+
+        // outbound data is held up to flushDelay ms, from heldSince
+        byte            holding;
+        unsigned long   heldSince;
+        uint16_t        flushDelay;
+
+        // RFC 860 round trip estimate, tmPending while our probe is out
+        byte            tmPending;
+        unsigned long   tmSent;
+        uint16_t        srtt;
+    };
 
-        uint8_t         buffer[1024];
-        uint8_t         bufferLen;
+    /*
+        A client struct together with its buffers, sized for the job.
+        A control port may get by with ClientBuffers<32, 64>, a bulk
+        transfer port wants the full TELNET_BUFFER_SIZE or more.
+    */
+    template <size_t NegoSize, size_t BufferSize>
+    struct ClientBuffers : public ClientStruct
+    {
+        static_assert(NegoSize <= (TelnetIndex)-1, "TelnetIndex cannot address NegoSize");
+        static_assert(BufferSize <= (TelnetIndex)-1, "TelnetIndex cannot address BufferSize");
+        static_assert(NegoSize >= 2, "NegoSize must hold an option and its command");
+        static_assert(BufferSize >= TELNET_BUFFER_HEADROOM, "BufferSize must hold TELNET_BUFFER_HEADROOM");
+
+        ClientBuffers()
+        {
+            negoBuffer = _negoStorage;
+            negoBufferSize = NegoSize;
+            buffer = _bufferStorage;
+            bufferSize = BufferSize;
+        }
+
+        // the base points into our storage, a copy would share it
+        ClientBuffers(const ClientBuffers &) = delete;
+        ClientBuffers &operator=(const ClientBuffers &) = delete;
+
+        // RAM used by one client of this configuration
+        static constexpr size_t footprint() { return sizeof(ClientBuffers); }
+
+        uint8_t         _negoStorage[NegoSize];
+        uint8_t         _bufferStorage[BufferSize];
     };
 
+    typedef ClientBuffers<TELNET_NEGO_BUFFER_SIZE, TELNET_BUFFER_SIZE> DefaultClientBuffers;
+
+    /*
+        starts a standalone server using str for its client instead
+        of allocating a DefaultClientBuffers.
+    */
+    template <size_t NegoSize, size_t BufferSize>
+    void begin(ClientBuffers<NegoSize, BufferSize> &str)
+    {
+        _begin(str);
+    }
+
+protected:
+
+    TelnetServer();
+
+    TelnetServer(int port);
+
+    /*
+        a client was just accepted, anything queued in str.buffer
+        goes out ahead of the first data.
+    */
+    virtual void _processConnect(WiFiClient &client, struct ClientStruct &str);
 
     // on 'false' the subnegotiation was not handled
     virtual bool _processSubNegotiation(WiFiClient &client, struct ClientStruct &str);
@@ -121,26 +285,103 @@ protected:
     */
     virtual bool _processOption(WiFiClient &client, struct ClientStruct &str);
 
+    /*
+        on 'false' the receiver has no room for more data, bytes are
+        left in the socket (and TCP window) until it does.
+    */
+    virtual bool _canReceive(struct ClientStruct &str);
+
     /*
         initializes the client struct
     */
     static void _initClient(struct ClientStruct &str);
 
+    // begin() with a caller's client struct, see begin(ClientBuffers<>&)
+    void _begin(struct ClientStruct &str);
+
+    /*
+        writes any pending outbound bytes in str.buffer to the client
+    */
+    static void _flush(WiFiClient &client, struct ClientStruct &str);
+
+    /*
+        folds a TIMING-MARK round trip sample into str.srtt and retunes
+        str.flushDelay, fast links get output immediately, slower ones
+        get it coalesced into fewer, larger segments.
+    */
+    static void _updateRtt(struct ClientStruct &str, unsigned long sample);
+
+    /*
+        on 'false' there is no client struct for a new session, a managed
+        server takes one from the manager's pool, a standalone server
+        uses the one given to, or allocated in, begin().
+    */
+    bool _acquireClientStr();
+
+    /*
+        hands a managed server's client struct back to the pool
+    */
+    void _releaseClientStr();
+
     /* our server */
-    WiFiServer _server;
+    TelnetWiFiServer _server;
 
     /* our single client -- This can be easy extended to support multiple
        clients --- but, consider.  What would happen say if one client turned
        on a motor and another client turned off a motor?  Does a firmware board
        really need to support multiple clients?  However, nothing prevents the 
        multiple servers running on different ports for different reasons....
+       see TelnetServerManager, which runs them from one poll and one pool.
     */
 
-    WiFiClient _client;
+    TelnetWiFiClient _client;
+
+#ifdef TELNET_TLS
+    /* ms spent in the handshake of the last accepted client */
+    unsigned long _handshakeTime;
+#endif
+
+    /* counts accepted clients, see session() */
+    uint16_t _session;
 
-    /* holds are client data, should we handle multiple clients */
-    struct ClientStruct _clientStr;
+    /* the manager we are registered with, if any */
+    TelnetServerManager *_manager;
+
+    /* holds are client data, NULL while a managed server is idle */
+    struct ClientStruct *_clientStr;
+
+    /* true when _clientStr was allocated by begin() */
+    bool _ownsClientStr;
+
+    /* see setPassive() */
+    bool _passive;
 };
 
+#ifdef TELNET_TLS
+/*
+    A fixed size TLS session cache with room for Sessions sessions,
+    the oldest is dropped when full.
+
+        SizedTelnetSessionCache<4> sessions;
+        Telnet.setCache(&sessions);
+*/
+template <uint8_t Sessions>
+class SizedTelnetSessionCache : public BearSSL::ServerSessions
+{
+public:
+
+    SizedTelnetSessionCache() :
+        BearSSL::ServerSessions(_sessionStorage, Sessions)
+    {
+    }
+
+    static constexpr size_t footprint() { return sizeof(SizedTelnetSessionCache); }
+
+protected:
+
+    BearSSL::ServerSession _sessionStorage[Sessions];
+};
+#endif
+
 #endif
 
@@ -0,0 +1,92 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    LRU cache of negotiated client capabilities.
+*/
+
+#include "TelnetCapabilityCache.h"
+
+TelnetCapabilityCache::TelnetCapabilityCache()
+{
+    clear();
+}
+
+void TelnetCapabilityCache::clear()
+{
+    for (uint8_t i = 0; i < TELNET_CAPABILITY_CACHE_SIZE; i++)
+        _entries[i].used = 0;
+
+    _clock = 0;
+}
+
+const TelnetCapabilities *TelnetCapabilityCache::find(uint32_t addr)
+{
+    TelnetCapabilities *found = NULL;
+
+    for (uint8_t i = 0; i < TELNET_CAPABILITY_CACHE_SIZE; i++)
+    {
+        TelnetCapabilities &e = _entries[i];
+        if (e.used != 0 && e.addr == addr && (found == NULL || e.used > found->used))
+            found = &e;
+    }
+
+    if (found != NULL)
+        found->used = ++_clock;
+
+    return found;
+}
+
+const TelnetCapabilities *TelnetCapabilityCache::find(uint32_t addr, const char *termType)
+{
+    for (uint8_t i = 0; i < TELNET_CAPABILITY_CACHE_SIZE; i++)
+    {
+        TelnetCapabilities &e = _entries[i];
+
+        // RFC 1091 terminal types are case insensitive
+        if (e.used != 0 && e.addr == addr && strcasecmp(e.termType, termType) == 0)
+        {
+            e.used = ++_clock;
+            return &e;
+        }
+    }
+
+    return NULL;
+}
+
+void TelnetCapabilityCache::store(const TelnetCapabilities &caps)
+{
+    TelnetCapabilities *slot = NULL;
+
+    for (uint8_t i = 0; i < TELNET_CAPABILITY_CACHE_SIZE; i++)
+    {
+        TelnetCapabilities &e = _entries[i];
+
+        if (e.used != 0 && e.addr == caps.addr && strcasecmp(e.termType, caps.termType) == 0)
+        {
+            slot = &e;
+            break;
+        }
+
+        // otherwise an empty entry, or the least recently used one
+        if (slot == NULL || e.used < slot->used)
+            slot = &e;
+    }
+
+    *slot = caps;
+    slot->used = ++_clock;
+}
@@ -0,0 +1,93 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Remembers what returning clients negotiated last time, keyed by peer
+    address and terminal type, so SimpleTelnetServer can start them off
+    with that profile rather than asking for everything again.  Holds
+    TELNET_CAPABILITY_CACHE_SIZE profiles, the least recently used one
+    is replaced when full.
+*/
+
+#ifndef _TELNETCAPABILITYCACHE_h
+#define _TELNETCAPABILITYCACHE_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+#include "Telnet.h"
+
+// bytes kept of the client's terminal type, with the NUL
+#define TELNET_TTYPE_SIZE               24
+
+#define TELNET_CAPABILITY_CACHE_SIZE    4
+
+// which of the options below the client agreed to
+#define TELNET_CAP_TTYPE                0x01
+#define TELNET_CAP_NAWS                 0x02
+#define TELNET_CAP_TSPEED               0x04
+#define TELNET_CAP_NEW_ENVIRON          0x08
+#define TELNET_CAP_ALL                  0x0f
+
+struct TelnetCapabilities
+{
+    uint32_t        addr;
+    char            termType[TELNET_TTYPE_SIZE];
+    byte            options;
+    uint16_t        cols;
+    uint16_t        rows;
+    unsigned long   txSpeed;
+    unsigned long   rxSpeed;
+
+    // higher is more recently used, 0 is an empty entry
+    uint32_t        used;
+};
+
+class TelnetCapabilityCache
+{
+public:
+
+    TelnetCapabilityCache();
+
+    /*
+        the most recently used profile of addr, whatever its terminal
+        type, or NULL.
+    */
+    const TelnetCapabilities *find(uint32_t addr);
+
+    /*
+        the profile of addr with termType, or NULL
+    */
+    const TelnetCapabilities *find(uint32_t addr, const char *termType);
+
+    /*
+        adds or updates the profile for caps.addr and caps.termType
+    */
+    void store(const TelnetCapabilities &caps);
+
+    void clear();
+
+protected:
+
+    TelnetCapabilities  _entries[TELNET_CAPABILITY_CACHE_SIZE];
+    uint32_t            _clock;
+};
+
+#endif
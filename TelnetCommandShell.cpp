@@ -0,0 +1,219 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    A small command shell on top of SimpleTelnetServer.
+*/
+
+#include "TelnetCommandShell.h"
+
+TelnetCommandShell::TelnetCommandShell(const TelnetCommand *commands, uint8_t count) :
+    _commands(commands),
+    _count(count)
+{
+}
+
+void TelnetCommandShell::poll(SimpleTelnetServer &server)
+{
+    char *line;
+
+    while ((line = server.readLine()) != NULL)
+        execute(line, server);
+}
+
+bool TelnetCommandShell::execute(char *line, Print &out)
+{
+    char *name = _nextToken(line);
+    if (name == NULL)
+        return false;
+
+    const TelnetCommand *cmd = _find(name);
+    if (cmd == NULL)
+    {
+        out.print("Unknown command: ");
+        out.println(name);
+        return false;
+    }
+
+    TelnetCommandArg argv[TELNET_SHELL_MAX_ARGS];
+    uint8_t argc = 0;
+    bool optional = false;
+
+    for (const char *spec = cmd->args; *spec; spec++)
+    {
+        if (*spec == '|')
+        {
+            optional = true;
+            continue;
+        }
+
+        if (argc == TELNET_SHELL_MAX_ARGS)
+            break;
+
+        char *token;
+        if (*spec == '*')
+        {
+            // the rest of the line, untouched
+            while (*line == ' ' || *line == '\t')
+                line++;
+
+            token = *line ? line : NULL;
+            line += strlen(line);
+        }
+        else
+            token = _nextToken(line);
+
+        if (token == NULL)
+        {
+            if (optional)
+                break;
+
+            out.print("Missing argument for ");
+            out.println(cmd->name);
+            return false;
+        }
+
+        if (!_parseArg(*spec, token, argv[argc]))
+        {
+            out.print("Bad argument: ");
+            out.println(token);
+            return false;
+        }
+
+        argc++;
+    }
+
+    if (_nextToken(line) != NULL)
+    {
+        out.print("Too many arguments for ");
+        out.println(cmd->name);
+        return false;
+    }
+
+    cmd->handler(out, argc, argv);
+    return true;
+}
+
+const TelnetCommand *TelnetCommandShell::_find(const char *name) const
+{
+    uint8_t low = 0;
+    uint8_t high = _count;
+
+    while (low < high)
+    {
+        uint8_t mid = low + (high - low) / 2;
+        int cmp = strcmp(name, _commands[mid].name);
+
+        if (cmp == 0)
+            return &_commands[mid];
+
+        if (cmp < 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    return NULL;
+}
+
+char *TelnetCommandShell::_nextToken(char *&line)
+{
+    while (*line == ' ' || *line == '\t')
+        line++;
+
+    if (*line == 0)
+        return NULL;
+
+    char *token = line;
+
+    if (*line == '"')
+    {
+        // quoted string, runs up to the closing quote
+        token++;
+        line++;
+        while (*line && *line != '"')
+            line++;
+    }
+    else
+    {
+        while (*line && *line != ' ' && *line != '\t')
+            line++;
+    }
+
+    if (*line)
+    {
+        *line = 0;
+        line++;
+    }
+
+    return token;
+}
+
+/*
+    Numbers are decimal unless they carry a 0x prefix; a leading zero
+    does not make them octal, so "010" is ten as the user expects.
+*/
+int TelnetCommandShell::_numberBase(const char *token)
+{
+    if (*token == '-' || *token == '+')
+        token++;
+
+    if (token[0] == '0' && (token[1] == 'x' || token[1] == 'X'))
+        return 16;
+
+    return 10;
+}
+
+bool TelnetCommandShell::_parseArg(char spec, char *token, TelnetCommandArg &arg)
+{
+    char *end;
+
+    switch (spec)
+    {
+        case 'i':
+        {
+            arg.i = strtol(token, &end, _numberBase(token));
+            return end != token && *end == 0;
+        }
+
+        case 'u':
+        {
+            if (*token == '-')
+                return false;
+            arg.u = strtoul(token, &end, _numberBase(token));
+            return end != token && *end == 0;
+        }
+
+        case 'x':
+        {
+            if (*token == '-')
+                return false;
+            arg.u = strtoul(token, &end, 16);
+            return end != token && *end == 0;
+        }
+
+        case 's':
+        case '*':
+        {
+            arg.s = token;
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,156 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    A small command shell on top of SimpleTelnetServer.
+
+    Commands are declared in a constexpr table sorted by name, which
+    TELNET_COMMANDS_CHECK() verifies at compile time, so a received line
+    is dispatched with a binary search: log2(n) name compares.  Lines are
+    split into arguments in place inside recvBuffer, nothing is allocated
+    or copied.
+
+    Example:
+
+        void setMotor(Print &out, uint8_t argc, const TelnetCommandArg *argv)
+        {
+            // argv[0].u is the motor, argv[1].i the speed
+        }
+
+        constexpr TelnetCommand commands[] =
+        {
+            TELNET_COMMAND("motor", "ui", setMotor),
+            TELNET_COMMAND("name",  "s|s", setName),
+        };
+        TELNET_COMMANDS_CHECK(commands);
+
+        TelnetCommandShell shell(commands, sizeof(commands) / sizeof(commands[0]));
+
+        void loop()
+        {
+            Telnet.handleClient();
+            shell.poll(Telnet);
+        }
+*/
+
+#ifndef _TELNETCOMMANDSHELL_h
+#define _TELNETCOMMANDSHELL_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+#include "SimpleTelnetServer.h"
+
+// most arguments a single command line can carry
+#define TELNET_SHELL_MAX_ARGS   8
+
+/*
+    A parsed argument, which member is valid depends on the argument
+    spec character of the command:
+
+        'i'  signed integer (decimal, or 0x hex)    -> i
+        'u'  unsigned integer (decimal, or 0x hex)  -> u
+        'x'  unsigned hex integer, 0x optional      -> u
+        's'  a single word, or a "quoted string"    -> s
+        '*'  the remainder of the line, as is       -> s
+
+    A '|' in the spec marks the arguments that follow it as optional.
+*/
+union TelnetCommandArg
+{
+    long            i;
+    unsigned long   u;
+    const char     *s;
+};
+
+typedef void (*TelnetCommandHandler)(Print &out, uint8_t argc, const TelnetCommandArg *argv);
+
+struct TelnetCommand
+{
+    const char             *name;
+    const char             *args;
+    TelnetCommandHandler    handler;
+};
+
+#define TELNET_COMMAND(name, args, handler) { name, args, handler }
+
+/*
+    strcmp() the compiler can evaluate, same order as the one _find() uses
+*/
+constexpr int telnetCommandCompare(const char *a, const char *b)
+{
+    return (*a != *b || *a == 0) ? (uint8_t)*a - (uint8_t)*b : telnetCommandCompare(a + 1, b + 1);
+}
+
+/*
+    true when the names of commands ascend strictly, so the table can be
+    binary searched and no name appears twice.
+*/
+template <size_t N>
+constexpr bool telnetCommandsSorted(const TelnetCommand (&commands)[N], size_t i = 1)
+{
+    return i >= N ||
+           (telnetCommandCompare(commands[i - 1].name, commands[i].name) < 0 && telnetCommandsSorted(commands, i + 1));
+}
+
+// fails the build unless commands is sorted by name, without duplicates
+#define TELNET_COMMANDS_CHECK(commands) \
+    static_assert(telnetCommandsSorted(commands), #commands " must be sorted by name, without duplicates")
+
+class TelnetCommandShell
+{
+public:
+
+    /*
+        commands must be sorted by name, see TELNET_COMMANDS_CHECK()
+    */
+    TelnetCommandShell(const TelnetCommand *commands, uint8_t count);
+
+    /*
+        dispatches every complete line waiting in the server's recvBuffer,
+        handler output goes back to the connected client.
+    */
+    void poll(SimpleTelnetServer &server);
+
+    /*
+        splits line in place and runs the matching command, on 'false'
+        the line was not dispatched and an error was printed to out.
+    */
+    bool execute(char *line, Print &out);
+
+protected:
+
+    // binary searches the table for name, returns NULL if it isn't there
+    const TelnetCommand *_find(const char *name) const;
+
+    // returns the next token of the line, or NULL at the end of it
+    static char *_nextToken(char *&line);
+
+    // 16 for a 0x prefixed number, 10 otherwise
+    static int _numberBase(const char *token);
+
+    // on 'false' the token does not match the spec character
+    static bool _parseArg(char spec, char *token, TelnetCommandArg &arg);
+
+    const TelnetCommand    *_commands;
+    uint8_t                 _count;
+};
+
+#endif
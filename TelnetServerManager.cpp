@@ -0,0 +1,102 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Runs several TelnetServers from one poll loop and one session pool.
+*/
+
+#include "TelnetServerManager.h"
+
+TelnetServerManager::TelnetServerManager() :
+    _serverCount(0),
+    _sessionCount(0)
+{
+}
+
+TelnetServerManager::~TelnetServerManager()
+{
+    end();
+
+    for (uint8_t i = 0; i < _serverCount; i++)
+        _servers[i]->_manager = NULL;
+}
+
+bool TelnetServerManager::add(TelnetServer &server)
+{
+    if (_serverCount == TELNET_MANAGER_MAX_PORTS)
+        return false;
+
+    // already ours, or running standalone with its own client struct
+    if (server._manager != NULL || server._clientStr != NULL)
+        return false;
+
+    server._manager = this;
+    _servers[_serverCount++] = &server;
+    return true;
+}
+
+bool TelnetServerManager::_addSession(TelnetServer::ClientStruct &str)
+{
+    if (_sessionCount == TELNET_MANAGER_MAX_SESSIONS)
+        return false;
+
+    _pool[_sessionCount] = &str;
+    _inUse[_sessionCount] = false;
+    _sessionCount++;
+    return true;
+}
+
+void TelnetServerManager::begin()
+{
+    for (uint8_t i = 0; i < _serverCount; i++)
+        _servers[i]->begin();
+}
+
+void TelnetServerManager::end()
+{
+    for (uint8_t i = 0; i < _serverCount; i++)
+        _servers[i]->end();
+}
+
+void TelnetServerManager::handleClients()
+{
+    for (uint8_t i = 0; i < _serverCount; i++)
+        _servers[i]->handleClient();
+}
+
+TelnetServer::ClientStruct *TelnetServerManager::_acquireClientStr()
+{
+    for (uint8_t i = 0; i < _sessionCount; i++)
+    {
+        if (!_inUse[i])
+        {
+            _inUse[i] = true;
+            return _pool[i];
+        }
+    }
+
+    return NULL;
+}
+
+void TelnetServerManager::_releaseClientStr(TelnetServer::ClientStruct *str)
+{
+    for (uint8_t i = 0; i < _sessionCount; i++)
+    {
+        if (_pool[i] == str)
+            _inUse[i] = false;
+    }
+}
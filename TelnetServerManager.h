@@ -0,0 +1,147 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Runs several TelnetServers, each on its own port, from a single
+    handleClients() call.  Registered servers do not keep a ClientStruct
+    of their own, a session takes one from a shared pool when a client
+    connects and returns it on disconnect.  So a console, data and log
+    port where at most two are used at once only pay for two sessions.
+
+    SizedTelnetServerManager<> brings its own pool, a plain
+    TelnetServerManager is given its sessions with addSession().
+
+    The pool only covers the client side.  Each server keeps its own
+    recvBuffer, which for a SimpleTelnetServer is TELNET_RECV_BUFFER_SIZE
+    bytes whether a client is connected or not, so managed servers are
+    best declared as SizedTelnetServer<> with what each port needs:
+
+        SizedTelnetServer<128> console(23);
+        SizedTelnetServer<256> data(2000);
+        SizedTelnetServer<8> log(2001);
+        SizedTelnetServerManager<2> telnet;
+
+        telnet.add(console);
+        telnet.add(data);
+        telnet.add(log);
+        telnet.begin();
+
+        void loop()
+        {
+            telnet.handleClients();
+        }
+
+    A client connecting while the pool is empty is turned away.
+*/
+
+#ifndef _TELNETSERVERMANAGER_h
+#define _TELNETSERVERMANAGER_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+#include "Telnet.h"
+
+// most servers (ports) one manager can run
+#define TELNET_MANAGER_MAX_PORTS        4
+
+// most concurrent sessions across all ports, one ClientStruct each
+#define TELNET_MANAGER_MAX_SESSIONS     4
+
+class TelnetServerManager
+{
+    friend class TelnetServer;
+
+public:
+
+    TelnetServerManager();
+
+    ~TelnetServerManager();
+
+    /*
+        registers a server, must be called before begin(). on 'false'
+        there is no room left or the server is already managed.
+    */
+    bool add(TelnetServer &server);
+
+    /*
+        adds a client struct to the session pool. on 'false' the
+        pool already holds TELNET_MANAGER_MAX_SESSIONS.
+    */
+    template <size_t NegoSize, size_t BufferSize>
+    bool addSession(TelnetServer::ClientBuffers<NegoSize, BufferSize> &str)
+    {
+        return _addSession(str);
+    }
+
+    void begin();
+    void end();
+
+    /*
+        services every registered server in one pass
+    */
+    void handleClients();
+
+protected:
+
+    bool _addSession(TelnetServer::ClientStruct &str);
+
+    // returns a free client struct from the pool, or NULL
+    TelnetServer::ClientStruct *_acquireClientStr();
+
+    void _releaseClientStr(TelnetServer::ClientStruct *str);
+
+    TelnetServer   *_servers[TELNET_MANAGER_MAX_PORTS];
+    uint8_t         _serverCount;
+
+    TelnetServer::ClientStruct *_pool[TELNET_MANAGER_MAX_SESSIONS];
+    bool                        _inUse[TELNET_MANAGER_MAX_SESSIONS];
+    uint8_t                     _sessionCount;
+};
+
+/*
+    A TelnetServerManager with a pool of Sessions client structs, each
+    with NegoSize and BufferSize byte buffers.  footprint() is the RAM
+    for the manager and its whole pool, not counting the servers.
+*/
+template <uint8_t Sessions,
+          size_t NegoSize = TELNET_NEGO_BUFFER_SIZE,
+          size_t BufferSize = TELNET_BUFFER_SIZE>
+class SizedTelnetServerManager : public TelnetServerManager
+{
+    static_assert(Sessions > 0, "a manager needs at least one session");
+    static_assert(Sessions <= TELNET_MANAGER_MAX_SESSIONS, "Sessions exceeds TELNET_MANAGER_MAX_SESSIONS");
+
+public:
+
+    SizedTelnetServerManager()
+    {
+        for (uint8_t i = 0; i < Sessions; i++)
+            addSession(_sessions[i]);
+    }
+
+    static constexpr size_t footprint() { return sizeof(SizedTelnetServerManager); }
+
+protected:
+
+    TelnetServer::ClientBuffers<NegoSize, BufferSize> _sessions[Sessions];
+};
+
+#endif
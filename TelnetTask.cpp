@@ -0,0 +1,56 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Protothread style interactive sessions.
+*/
+
+#include "TelnetTask.h"
+
+TelnetTask::TelnetTask() :
+    _resume(0),
+    _session(0),
+    _wakeAt(0)
+{
+}
+
+TelnetTask::~TelnetTask()
+{
+}
+
+void TelnetTask::poll(SimpleTelnetServer &server)
+{
+    if (!server.connected())
+        return;
+
+    // a new client starts from the top
+    if (server.session() != _session)
+    {
+        _session = server.session();
+        _resume = 0;
+    }
+
+    if (_resume == TELNET_TASK_FINISHED)
+        return;
+
+    run(server);
+}
+
+bool TelnetTask::done()
+{
+    return _resume == TELNET_TASK_FINISHED;
+}
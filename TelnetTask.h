@@ -0,0 +1,354 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Interactive sessions (login, menus, confirmations) written as straight
+    line code rather than a hand rolled state machine, without a stack
+    per session and without delay().
+
+    TelnetTask is a protothread, it works on the C++11 ESP8266 toolchain.
+    run() is written between TELNET_TASK_BEGIN() and TELNET_TASK_END(),
+    and returns to the caller wherever it has to wait.  Only the members
+    of the task survive a wait, locals do not, and run() must not use a
+    switch statement of its own.  A task costs its members plus a dozen
+    bytes.
+
+        class Login : public TelnetTask
+        {
+            char *line;
+            uint8_t tries;
+
+            virtual char run(SimpleTelnetServer &t)
+            {
+                TELNET_TASK_BEGIN();
+
+                for (tries = 0; tries < 3; tries++)
+                {
+                    TELNET_TASK_WRITE(t, "password: ");
+                    TELNET_TASK_READ_LINE(t, line);
+                    if (strcmp(line, "secret") == 0)
+                        break;
+                    TELNET_TASK_SLEEP(1000);
+                }
+
+                ...
+                TELNET_TASK_END();
+            }
+        };
+
+        Login login;
+
+        void loop()
+        {
+            Telnet.handleClient();
+            login.poll(Telnet);
+        }
+
+    Where C++20 coroutines are available (a host build, say) TelnetCoroutine
+    offers the same with co_await, see below.
+*/
+
+#ifndef _TELNETTASK_h
+#define _TELNETTASK_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+#include "SimpleTelnetServer.h"
+
+// what run() returns
+#define TELNET_TASK_WAITING     0
+#define TELNET_TASK_DONE        1
+
+// starts the body of run()
+#define TELNET_TASK_BEGIN()                                 \
+    switch (_resume) { case 0:
+
+// ends the body of run(), the task rests until the next client
+#define TELNET_TASK_END()                                   \
+    } _resume = TELNET_TASK_FINISHED; return TELNET_TASK_DONE
+
+// finishes the task early, from anywhere in run()
+#define TELNET_TASK_EXIT()                                  \
+    do { _resume = TELNET_TASK_FINISHED; return TELNET_TASK_DONE; } while (0)
+
+// gives the other tasks a turn, continues on the next poll()
+#define TELNET_TASK_YIELD()                                 \
+    do { _resume = __LINE__; return TELNET_TASK_WAITING;    \
+         case __LINE__:; } while (0)
+
+// returns to the caller until cond holds
+#define TELNET_TASK_WAIT_UNTIL(cond)                        \
+    do { _resume = __LINE__; case __LINE__:                 \
+         if (!(cond)) return TELNET_TASK_WAITING; } while (0)
+
+// waits for a complete line from the client, see readLine()
+#define TELNET_TASK_READ_LINE(server, line)                 \
+    TELNET_TASK_WAIT_UNTIL(((line) = (server).readLine()) != NULL)
+
+// waits for room in the outbound buffer, then queues text
+#define TELNET_TASK_WRITE(server, text)                     \
+    do { TELNET_TASK_WAIT_UNTIL((server).writeReady(strlen(text))); \
+         (server).print(text); } while (0)
+
+// waits ms without holding up anything else
+#define TELNET_TASK_SLEEP(ms)                               \
+    do { _wakeAt = millis() + (ms);                         \
+         TELNET_TASK_WAIT_UNTIL((long)(millis() - _wakeAt) >= 0); } while (0)
+
+class TelnetTask
+{
+public:
+
+    TelnetTask();
+
+    virtual ~TelnetTask();
+
+    /*
+        runs the task until it has to wait.  It starts over for every new
+        client, and stops where it is when the client goes away.
+    */
+    void poll(SimpleTelnetServer &server);
+
+    // true once run() reached TELNET_TASK_END() for this client
+    bool done();
+
+protected:
+
+    // __LINE__ of the wait to resume at, 0 to start over
+    enum { TELNET_TASK_FINISHED = 0xffff };
+
+    // on TELNET_TASK_DONE the task has finished for this client
+    virtual char run(SimpleTelnetServer &server) = 0;
+
+    uint16_t        _resume;
+    uint16_t        _session;
+    unsigned long   _wakeAt;
+};
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+
+/*
+    The C++20 version, the session is a coroutine and the frame the
+    compiler allocates for it holds what the task members hold above.
+    TelnetCoroutineTask starts a fresh frame for every new client, as
+    TelnetTask starts run() over, so no client resumes another's.
+
+        TelnetCoroutine login(SimpleTelnetServer &t)
+        {
+            co_await TelnetWrite(t, "password: ");
+            char *line = co_await TelnetReadLine(t);
+            ...
+        }
+
+        TelnetCoroutineTask session(login);
+
+        void loop()
+        {
+            Telnet.handleClient();
+            session.poll(Telnet);
+        }
+*/
+class TelnetCoroutine
+{
+public:
+
+    struct promise_type
+    {
+        // the awaiter we are suspended on, and how to ask it
+        void   *waiter = nullptr;
+        bool  (*ready)(void *waiter) = nullptr;
+
+        TelnetCoroutine get_return_object()
+        {
+            return TelnetCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    TelnetCoroutine() : _handle(nullptr) {}
+
+    explicit TelnetCoroutine(Handle handle) : _handle(handle) {}
+
+    TelnetCoroutine(TelnetCoroutine &&other) : _handle(other._handle) { other._handle = nullptr; }
+
+    TelnetCoroutine &operator=(TelnetCoroutine &&other)
+    {
+        if (this != &other)
+        {
+            if (_handle)
+                _handle.destroy();
+
+            _handle = other._handle;
+            other._handle = nullptr;
+        }
+
+        return *this;
+    }
+
+    TelnetCoroutine(const TelnetCoroutine &) = delete;
+    TelnetCoroutine &operator=(const TelnetCoroutine &) = delete;
+
+    ~TelnetCoroutine()
+    {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    /*
+        resumes the coroutine if what it waits for has happened
+    */
+    void poll()
+    {
+        if (!_handle || _handle.done())
+            return;
+
+        promise_type &p = _handle.promise();
+        if (p.ready != nullptr && !p.ready(p.waiter))
+            return;
+
+        p.ready = nullptr;
+        _handle.resume();
+    }
+
+    bool done() { return !_handle || _handle.done(); }
+
+    /*
+        base of the awaiters below, Derived::check() tells when to resume
+    */
+    template <class Derived>
+    struct Awaiter
+    {
+        bool await_ready() { return static_cast<Derived *>(this)->check(); }
+
+        void await_suspend(Handle handle)
+        {
+            handle.promise().waiter = static_cast<Derived *>(this);
+            handle.promise().ready = &Awaiter::_ready;
+        }
+
+        static bool _ready(void *waiter) { return static_cast<Derived *>(waiter)->check(); }
+    };
+
+private:
+
+    Handle _handle;
+};
+
+/*
+    runs a coroutine per client, start is called for every new session
+    and the frame of the previous one, wherever it was waiting, destroyed.
+*/
+class TelnetCoroutineTask
+{
+public:
+
+    typedef TelnetCoroutine (*Start)(SimpleTelnetServer &server);
+
+    explicit TelnetCoroutineTask(Start start) : _start(start), _session(0) {}
+
+    /*
+        resumes the coroutine if what it waits for has happened.  It
+        starts over for every new client, and stops where it is when
+        the client goes away.
+    */
+    void poll(SimpleTelnetServer &server)
+    {
+        if (!server.connected())
+            return;
+
+        // a new client starts from the top
+        if (server.session() != _session)
+        {
+            _session = server.session();
+            _coroutine = _start(server);
+        }
+
+        _coroutine.poll();
+    }
+
+    // true once the coroutine returned for this client
+    bool done() { return _coroutine.done(); }
+
+protected:
+
+    Start           _start;
+    uint16_t        _session;
+    TelnetCoroutine _coroutine;
+};
+
+// resumes with the next complete line, see SimpleTelnetServer::readLine()
+struct TelnetReadLine : TelnetCoroutine::Awaiter<TelnetReadLine>
+{
+    TelnetReadLine(SimpleTelnetServer &server) : _server(server), _line(nullptr) {}
+
+    bool check() { return (_line = _server.readLine()) != nullptr; }
+    char *await_resume() { return _line; }
+
+    SimpleTelnetServer &_server;
+    char               *_line;
+};
+
+// resumes once text fits the outbound buffer, having queued it
+struct TelnetWrite : TelnetCoroutine::Awaiter<TelnetWrite>
+{
+    TelnetWrite(SimpleTelnetServer &server, const char *text) : _server(server), _text(text) {}
+
+    bool check() { return _server.writeReady(strlen(_text)); }
+    void await_resume() { _server.print(_text); }
+
+    SimpleTelnetServer &_server;
+    const char         *_text;
+};
+
+// resumes after ms
+struct TelnetSleep : TelnetCoroutine::Awaiter<TelnetSleep>
+{
+    TelnetSleep(unsigned long ms) : _wakeAt(millis() + ms) {}
+
+    bool check() { return (long)(millis() - _wakeAt) >= 0; }
+    void await_resume() {}
+
+    unsigned long _wakeAt;
+};
+
+// resumes once a client is connected
+struct TelnetConnected : TelnetCoroutine::Awaiter<TelnetConnected>
+{
+    TelnetConnected(SimpleTelnetServer &server) : _server(server) {}
+
+    bool check() { return _server.connected(); }
+    void await_resume() {}
+
+    SimpleTelnetServer &_server;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+#include <ESP8266WiFi.h>
+#include <SimpleTelnetServer.h>
+#include <TelnetCommandShell.h>
+#include <Telnet.h>
+
+const char* ssid = "**********";
+const char* password = "**********";
+
+SimpleTelnetServer Telnet;
+
+void cmdLed(Print &out, uint8_t argc, const TelnetCommandArg *argv)
+{
+    // led <pin> <0|1>
+    pinMode(argv[0].u, OUTPUT);
+    digitalWrite(argv[0].u, argv[1].u ? HIGH : LOW);
+    out.println("OK");
+}
+
+void cmdEcho(Print &out, uint8_t argc, const TelnetCommandArg *argv)
+{
+    // echo [text...]
+    if (argc > 0)
+        out.print(argv[0].s);
+    out.println("");
+}
+
+void cmdUptime(Print &out, uint8_t argc, const TelnetCommandArg *argv)
+{
+    out.println(millis());
+}
+
+// sorted by name, the shell binary searches it
+constexpr TelnetCommand commands[] =
+{
+    TELNET_COMMAND("echo",   "|*",  cmdEcho),
+    TELNET_COMMAND("led",    "uu",  cmdLed),
+    TELNET_COMMAND("uptime", "",    cmdUptime),
+};
+TELNET_COMMANDS_CHECK(commands);
+
+TelnetCommandShell Shell(commands, sizeof(commands) / sizeof(commands[0]));
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.begin(ssid, password);
+  Serial.print("\nConnecting to "); Serial.println(ssid);
+  uint8_t i = 0;
+  while (WiFi.status() != WL_CONNECTED && i++ < 20) delay(500);
+  if(i == 21){
+    Serial.print("Could not connect to"); Serial.println(ssid);
+    while(1) delay(500);
+  }
+
+  Telnet.begin();
+
+  Serial.print("Ready! Use 'telnet ");
+  Serial.print(WiFi.localIP());
+  Serial.println(" 23' to connect");
+}
+
+void loop() {
+
+    Telnet.handleClient();
+
+    // runs every complete line received since the last pass
+    Shell.poll(Telnet);
+}
@@ -0,0 +1,104 @@
+#include <ESP8266WiFi.h>
+#include <SimpleTelnetServer.h>
+#include <TelnetServerManager.h>
+#include <TelnetTask.h>
+#include <TelnetCapabilityCache.h>
+#include <Telnet.h>
+
+const char* ssid = "**********";
+const char* password = "**********";
+
+/*
+ *  A login prompt followed by a tiny menu, one task per port.  While
+ *  one session waits for its user, the other keeps running.
+ */
+class Session : public TelnetTask
+{
+protected:
+
+    char   *line;
+    uint8_t tries;
+
+    virtual char run(SimpleTelnetServer &t)
+    {
+        TELNET_TASK_BEGIN();
+
+        // at once for a terminal the capability cache knows
+        TELNET_TASK_WAIT_UNTIL(t.terminalReady());
+        if (t.terminalType()[0])
+        {
+            t.print("Hello ");
+            t.print(t.terminalType());
+            t.print("\r\n");
+        }
+
+        for (tries = 0; tries < 3; tries++)
+        {
+            TELNET_TASK_WRITE(t, "password: ");
+            TELNET_TASK_READ_LINE(t, line);
+            if (strcmp(line, "secret") == 0)
+                break;
+
+            // slow down guessing, without blocking the other session
+            TELNET_TASK_SLEEP(2000);
+        }
+
+        if (tries == 3)
+        {
+            TELNET_TASK_WRITE(t, "Goodbye\r\n");
+            TELNET_TASK_EXIT();
+        }
+
+        for (;;)
+        {
+            TELNET_TASK_WRITE(t, "1) uptime  2) heap\r\n> ");
+            TELNET_TASK_READ_LINE(t, line);
+
+            if (line[0] == '1')
+                t.println(millis());
+            else if (line[0] == '2')
+                t.println(ESP.getFreeHeap());
+        }
+
+        TELNET_TASK_END();
+    }
+};
+
+SizedTelnetServer<128> Console(23);
+SizedTelnetServer<128> Service(2323);
+SizedTelnetServerManager<2, 32, 256> Telnet;
+TelnetCapabilityCache Terminals;
+
+Session ConsoleSession;
+Session ServiceSession;
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.begin(ssid, password);
+  Serial.print("\nConnecting to "); Serial.println(ssid);
+  uint8_t i = 0;
+  while (WiFi.status() != WL_CONNECTED && i++ < 20) delay(500);
+  if(i == 21){
+    Serial.print("Could not connect to"); Serial.println(ssid);
+    while(1) delay(500);
+  }
+
+  Console.setCapabilityCache(&Terminals);
+  Service.setCapabilityCache(&Terminals);
+
+  Telnet.add(Console);
+  Telnet.add(Service);
+  Telnet.begin();
+
+  Serial.print("Ready! Use 'telnet ");
+  Serial.print(WiFi.localIP());
+  Serial.println(" 23' or 2323 to connect");
+}
+
+void loop() {
+
+    Telnet.handleClients();
+
+    ConsoleSession.poll(Console);
+    ServiceSession.poll(Service);
+}
@@ -0,0 +1,66 @@
+#include <ESP8266WiFi.h>
+#include <SimpleTelnetServer.h>
+#include <TelnetServerManager.h>
+#include <Telnet.h>
+
+const char* ssid = "**********";
+const char* password = "**********";
+
+// a console, a raw data port and a log port.  Only
+// two of them can be connected at once.  Each is given
+// the receive buffer it needs, the log port takes no input.
+SizedTelnetServer<128> Console(23);
+SizedTelnetServer<256> Data(2000);
+SizedTelnetServer<8> Log(2001);
+
+SizedTelnetServerManager<2> Telnet;
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.begin(ssid, password);
+  Serial.print("\nConnecting to "); Serial.println(ssid);
+  uint8_t i = 0;
+  while (WiFi.status() != WL_CONNECTED && i++ < 20) delay(500);
+  if(i == 21){
+    Serial.print("Could not connect to"); Serial.println(ssid);
+    while(1) delay(500);
+  }
+
+  // the data port carries raw bytes, keep telnet negotiation off it
+  Data.setPassive(true);
+
+  Telnet.add(Console);
+  Telnet.add(Data);
+  Telnet.add(Log);
+  Telnet.begin();
+
+  Serial.print("Session pool uses ");
+  Serial.print(Telnet.footprint());
+  Serial.print(" bytes, servers ");
+  Serial.print(Console.footprint() + Data.footprint() + Log.footprint());
+  Serial.println(" bytes");
+
+  Serial.print("Ready! Use 'telnet ");
+  Serial.print(WiFi.localIP());
+  Serial.println(" 23', 2000 or 2001 to connect");
+}
+
+void loop() {
+
+    // one pass over all three ports
+    Telnet.handleClients();
+
+    char *line;
+    while ((line = Console.readLine()) != NULL)
+    {
+        Log.print("console: ");
+        Log.println(line);
+    }
+
+    // forward raw data to the UART
+    if (Data.recvBufLen > 0)
+    {
+        Serial.write(Data.recvBuffer, Data.recvBufLen);
+        Data.recvBufLen = 0;
+    }
+}
@@ -0,0 +1,32 @@
+/*
+    Instantiates the C++20 half of TelnetTask.h, which the C++11
+    ESP8266 toolchain never sees.
+*/
+
+#include "TelnetTask.h"
+
+#if !defined(__cpp_impl_coroutine)
+#error "needs a C++20 compiler with coroutine support"
+#endif
+
+static TelnetCoroutine login(SimpleTelnetServer &t)
+{
+    co_await TelnetConnected(t);
+
+    for (uint8_t tries = 0; tries < 3; tries++)
+    {
+        co_await TelnetWrite(t, "password: ");
+        char *line = co_await TelnetReadLine(t);
+        if (strcmp(line, "secret") == 0)
+            co_return;
+        co_await TelnetSleep(1000);
+    }
+}
+
+void coroutineCheck(SimpleTelnetServer &server)
+{
+    static TelnetCoroutineTask session(login);
+
+    session.poll(server);
+    (void)session.done();
+}
@@ -0,0 +1,195 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Times full and resumed TLS handshakes with BearSSL, the library the
+    ESP8266 core's WiFiServerSecure and ServerSessions are built on.  The
+    server is set up as TELNET_TLS does it, an EC certificate and an LRU
+    session cache the size of a SizedTelnetSessionCache<4>, and a local
+    client connects to it over an in memory pipe, first always asking
+    for a new session, then resuming the one it has.
+
+    The time each side spends in BearSSL is kept apart, the server's is
+    what handshakeTime() measures on the device, a few times over for
+    the ESP8266's slower CPU.  See the Makefile for how to build it.
+*/
+
+#include <bearssl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// connections per measurement
+#define BENCH_ROUNDS        50
+
+// sessions the server keeps, see SizedTelnetSessionCache<>
+#define BENCH_CACHE_SIZE    4
+
+static double _now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// ms each side spent in BearSSL for one handshake
+struct Timing
+{
+    double server;
+    double client;
+};
+
+/*
+    moves records from one engine to the other, as far as the receiver
+    takes them, charging the work each engine does to its own side.
+*/
+static bool _transfer(br_ssl_engine_context *from, double &fromTime,
+                      br_ssl_engine_context *to, double &toTime)
+{
+    if (!(br_ssl_engine_current_state(from) & BR_SSL_SENDREC) ||
+        !(br_ssl_engine_current_state(to) & BR_SSL_RECVREC))
+        return false;
+
+    size_t sendLen, recvLen;
+    unsigned char *send = br_ssl_engine_sendrec_buf(from, &sendLen);
+    unsigned char *recv = br_ssl_engine_recvrec_buf(to, &recvLen);
+    size_t len = sendLen < recvLen ? sendLen : recvLen;
+
+    memcpy(recv, send, len);
+
+    double start = _now();
+    br_ssl_engine_sendrec_ack(from, len);
+    fromTime += _now() - start;
+
+    start = _now();
+    br_ssl_engine_recvrec_ack(to, len);
+    toTime += _now() - start;
+
+    return true;
+}
+
+// runs the handshake to completion, on 'false' it failed
+static bool _handshake(br_ssl_server_context &server, br_ssl_client_context &client, Timing &timing)
+{
+    for (;;)
+    {
+        unsigned s = br_ssl_engine_current_state(&server.eng);
+        unsigned c = br_ssl_engine_current_state(&client.eng);
+
+        if ((s & BR_SSL_CLOSED) || (c & BR_SSL_CLOSED))
+            return false;
+
+        // both sides may send application data, we are through
+        if ((s & BR_SSL_SENDAPP) && (c & BR_SSL_SENDAPP))
+            return true;
+
+        bool moved = _transfer(&client.eng, timing.client, &server.eng, timing.server);
+        moved |= _transfer(&server.eng, timing.server, &client.eng, timing.client);
+
+        if (!moved)
+            return false;
+    }
+}
+
+int main()
+{
+    // a fixed seed, the benchmark needs keys, not secret ones
+    static const char seed[] = "ESP8266RFCTelnet handshake bench";
+    br_hmac_drbg_context rng;
+    br_hmac_drbg_init(&rng, &br_sha256_vtable, seed, sizeof(seed));
+
+    const br_ec_impl *ec = br_ec_get_default();
+
+    static unsigned char skBuf[BR_EC_KBUF_PRIV_MAX_SIZE];
+    static unsigned char pkBuf[BR_EC_KBUF_PUB_MAX_SIZE];
+    br_ec_private_key sk;
+    br_ec_public_key pk;
+
+    if (br_ec_keygen(&rng.vtable, ec, &sk, skBuf, BR_EC_secp256r1) == 0 ||
+        br_ec_compute_pub(ec, &pk, pkBuf, &sk) == 0)
+    {
+        printf("EC key generation failed\n");
+        return 1;
+    }
+
+    // the client knows the server's key, so the certificate it is sent
+    // is never parsed and need not be a real one.
+    static unsigned char certData[] = { 0x30, 0x00 };
+    br_x509_certificate chain = { certData, sizeof(certData) };
+
+    static unsigned char cacheStore[BENCH_CACHE_SIZE * 100];
+    br_ssl_session_cache_lru cache;
+    br_ssl_session_cache_lru_init(&cache, cacheStore, sizeof(cacheStore));
+
+    static br_ssl_server_context server;
+    static unsigned char serverBuf[BR_SSL_BUFSIZE_BIDI];
+    br_ssl_server_init_full_ec(&server, &chain, 1, BR_KEYTYPE_EC, &sk);
+    br_ssl_server_set_cache(&server, &cache.vtable);
+    br_ssl_engine_set_buffer(&server.eng, serverBuf, sizeof(serverBuf), 1);
+
+    static br_ssl_client_context client;
+    static br_x509_minimal_context minimal;
+    static br_x509_knownkey_context known;
+    static unsigned char clientBuf[BR_SSL_BUFSIZE_BIDI];
+    br_ssl_client_init_full(&client, &minimal, NULL, 0);
+    br_x509_knownkey_init_ec(&known, &pk, BR_KEYTYPE_KEYX | BR_KEYTYPE_SIGN);
+    br_ssl_engine_set_x509(&client.eng, &known.vtable);
+    br_ssl_engine_set_buffer(&client.eng, clientBuf, sizeof(clientBuf), 1);
+
+    br_ssl_session_parameters session;
+    Timing full = { 0, 0 }, resumed = { 0, 0 };
+    int resumes = 0;
+
+    for (int round = 0; round < 2 * BENCH_ROUNDS; round++)
+    {
+        bool resume = round >= BENCH_ROUNDS;
+
+        if (resume)
+            br_ssl_engine_set_session_parameters(&client.eng, &session);
+
+        br_ssl_server_reset(&server);
+        br_ssl_client_reset(&client, "localhost", resume);
+
+        if (!_handshake(server, client, resume ? resumed : full))
+        {
+            printf("handshake failed, server error %d, client error %d\n",
+                   br_ssl_engine_last_error(&server.eng), br_ssl_engine_last_error(&client.eng));
+            return 1;
+        }
+
+        // the same session id again means the server resumed it
+        br_ssl_session_parameters now;
+        br_ssl_engine_get_session_parameters(&client.eng, &now);
+
+        if (resume && now.session_id_len == session.session_id_len &&
+            memcmp(now.session_id, session.session_id, session.session_id_len) == 0)
+            resumes++;
+
+        if (!resume)
+            session = now;
+    }
+
+    printf("%d handshakes each, ECDHE-ECDSA P-256, ms per handshake\n", BENCH_ROUNDS);
+    printf("  full:     server %7.3f  client %7.3f\n", full.server / BENCH_ROUNDS, full.client / BENCH_ROUNDS);
+    printf("  resumed:  server %7.3f  client %7.3f  (%d of %d resumed)\n",
+           resumed.server / BENCH_ROUNDS, resumed.client / BENCH_ROUNDS, resumes, BENCH_ROUNDS);
+
+    if (resumed.server > 0)
+        printf("  the server side of a resumed handshake is %.1fx faster\n", full.server / resumed.server);
+
+    return resumes == BENCH_ROUNDS ? 0 : 1;
+}
@@ -0,0 +1,614 @@
+/*
+    Telnet support for the ESP8266 Wifi.
+    Copyright (c) 2016 Kenneth S. Davis, All rights reserved.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Runs the library against the fake network of stubs/host.h, a client
+    at a time, and checks what comes out.  Built and run by "make test",
+    a failed check prints its line and the run exits non-zero.
+*/
+
+#include <string>
+
+#include "host.h"
+#include "SimpleTelnetServer.h"
+#include "TelnetCapabilityCache.h"
+#include "TelnetCommandShell.h"
+#include "TelnetTask.h"
+
+static int _checks;
+static int _failures;
+
+#define CHECK(cond)                                                     \
+    do { _checks++;                                                     \
+         if (!(cond)) { _failures++;                                    \
+             printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while (0)
+
+// a is evaluated once, it may be a readLine()
+#define CHECK_STR(a, b)     CHECK(_equal((a), (b)))
+
+static bool _equal(const char *a, const char *b)
+{
+    return a != NULL && strcmp(a, b) == 0;
+}
+
+// a client on its way in, the server accepts it with the next handleClient()
+static void _connect(TelnetServer &server, uint32_t ip = 0x0a000001)
+{
+    HostNet::connect(ip);
+    server.handleClient();
+}
+
+static void _disconnect(TelnetServer &server)
+{
+    HostNet::connected = false;
+    server.handleClient();
+}
+
+static void _send(const char *data)
+{
+    HostNet::input += data;
+}
+
+/*
+    readLine()
+*/
+
+static void testReadLine()
+{
+    SizedTelnetServer<16> server(23);
+    TelnetServer::ClientBuffers<32, 64> client;
+
+    server.setPassive(true);
+    server.begin(client);
+    _connect(server);
+
+    // empty lines are skipped, any of CR, LF and NUL ends a line
+    _send("one\r\n\r\ntwo\n");
+    server.handleClient();
+    CHECK_STR(server.readLine(), "one");
+    CHECK_STR(server.readLine(), "two");
+    CHECK(server.readLine() == NULL);
+
+    // half a line waits for the rest
+    _send("thr");
+    server.handleClient();
+    CHECK(server.readLine() == NULL);
+    _send("ee\r");
+    server.handleClient();
+    CHECK_STR(server.readLine(), "three");
+
+    // an overlong line goes whole, its tail never shows up as a line
+    _send("0123456789abcdefghijklmnop\r\nafter\r\n");
+
+    int lines = 0;
+    std::string line;
+
+    for (int i = 0; i < 8; i++)
+    {
+        server.handleClient();
+
+        char *got = server.readLine();
+        if (got != NULL)
+        {
+            lines++;
+            line = got;
+        }
+    }
+
+    CHECK(lines == 1);
+    CHECK(line == "after");
+    CHECK(HostNet::input.empty());
+
+    // a new client starts with an empty recvBuffer
+    _send("left over");
+    server.handleClient();
+    _disconnect(server);
+    _connect(server);
+    _send("fresh\r\n");
+    server.handleClient();
+    CHECK_STR(server.readLine(), "fresh");
+
+    _disconnect(server);
+    server.end();
+}
+
+/*
+    TelnetCommandShell
+*/
+
+// exposes the shell's parsing to the tests
+class ShellProbe : public TelnetCommandShell
+{
+public:
+
+    using TelnetCommandShell::TelnetCommandShell;
+    using TelnetCommandShell::_find;
+    using TelnetCommandShell::_nextToken;
+    using TelnetCommandShell::_numberBase;
+    using TelnetCommandShell::_parseArg;
+};
+
+// the output of a command
+class Capture : public Print
+{
+public:
+
+    virtual size_t write(uint8_t c)
+    {
+        text += (char)c;
+        return 1;
+    }
+
+    using Print::write;
+
+    std::string text;
+};
+
+static uint8_t _argc;
+static TelnetCommandArg _argv[TELNET_SHELL_MAX_ARGS];
+static const char *_ran;
+
+static void _record(const char *name, uint8_t argc, const TelnetCommandArg *argv)
+{
+    _ran = name;
+    _argc = argc;
+    memcpy(_argv, argv, argc * sizeof(argv[0]));
+}
+
+static void _cmdAdd(Print &out, uint8_t argc, const TelnetCommandArg *argv) { _record("add", argc, argv); }
+static void _cmdPoke(Print &out, uint8_t argc, const TelnetCommandArg *argv) { _record("poke", argc, argv); }
+static void _cmdSay(Print &out, uint8_t argc, const TelnetCommandArg *argv) { _record("say", argc, argv); }
+static void _cmdSet(Print &out, uint8_t argc, const TelnetCommandArg *argv) { _record("set", argc, argv); }
+
+static constexpr TelnetCommand _commands[] =
+{
+    TELNET_COMMAND("add",  "ii",   _cmdAdd),
+    TELNET_COMMAND("poke", "xu",   _cmdPoke),
+    TELNET_COMMAND("say",  "*",    _cmdSay),
+    TELNET_COMMAND("set",  "s|s",  _cmdSet),
+};
+TELNET_COMMANDS_CHECK(_commands);
+
+static constexpr TelnetCommand _unsorted[] =
+{
+    TELNET_COMMAND("set",  "",     _cmdSet),
+    TELNET_COMMAND("add",  "",     _cmdAdd),
+};
+static_assert(!telnetCommandsSorted(_unsorted), "an unsorted table must fail TELNET_COMMANDS_CHECK()");
+
+static constexpr TelnetCommand _duplicate[] =
+{
+    TELNET_COMMAND("add",  "",     _cmdAdd),
+    TELNET_COMMAND("add",  "",     _cmdAdd),
+};
+static_assert(!telnetCommandsSorted(_duplicate), "a duplicate must fail TELNET_COMMANDS_CHECK()");
+
+static void testTokenizer()
+{
+    char line[] = "  set\t\"two words\"  last ";
+    char *rest = line;
+
+    CHECK_STR(ShellProbe::_nextToken(rest), "set");
+    CHECK_STR(ShellProbe::_nextToken(rest), "two words");
+    CHECK_STR(ShellProbe::_nextToken(rest), "last");
+    CHECK(ShellProbe::_nextToken(rest) == NULL);
+
+    // an unterminated quote runs to the end of the line
+    char open[] = "\"no end";
+    rest = open;
+    CHECK_STR(ShellProbe::_nextToken(rest), "no end");
+    CHECK(ShellProbe::_nextToken(rest) == NULL);
+
+    char blank[] = " \t ";
+    rest = blank;
+    CHECK(ShellProbe::_nextToken(rest) == NULL);
+}
+
+static void testNumbers()
+{
+    CHECK(ShellProbe::_numberBase("10") == 10);
+    CHECK(ShellProbe::_numberBase("010") == 10);
+    CHECK(ShellProbe::_numberBase("0x10") == 16);
+    CHECK(ShellProbe::_numberBase("-0X10") == 16);
+
+    TelnetCommandArg arg;
+    char buf[16];
+
+    struct { char spec; const char *token; bool ok; long value; } cases[] =
+    {
+        { 'i', "42",    true,  42 },
+        { 'i', "-42",   true,  -42 },
+        { 'i', "010",   true,  10 },
+        { 'i', "0x1f",  true,  31 },
+        { 'i', "-0x10", true,  -16 },
+        { 'i', "12ab",  false, 0 },
+        { 'i', "",      false, 0 },
+        { 'u', "7",     true,  7 },
+        { 'u', "-7",    false, 0 },
+        { 'x', "ff",    true,  255 },
+        { 'x', "0xFF",  true,  255 },
+        { 'x', "fg",    false, 0 },
+        { '?', "1",     false, 0 },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        strcpy(buf, cases[i].token);
+        bool ok = ShellProbe::_parseArg(cases[i].spec, buf, arg);
+
+        CHECK(ok == cases[i].ok);
+        if (ok && cases[i].spec == 'i')
+            CHECK(arg.i == cases[i].value);
+        else if (ok)
+            CHECK(arg.u == (unsigned long)cases[i].value);
+    }
+}
+
+static void testShell()
+{
+    ShellProbe shell(_commands, sizeof(_commands) / sizeof(_commands[0]));
+    Capture out;
+
+    char add[] = "add -3 0x10";
+    _ran = NULL;
+    CHECK(shell.execute(add, out));
+    CHECK_STR(_ran, "add");
+    CHECK(_argc == 2 && _argv[0].i == -3 && _argv[1].i == 16);
+
+    char say[] = "say   hello \"there\"  ";
+    CHECK(shell.execute(say, out));
+    CHECK_STR(_ran, "say");
+    CHECK(_argc == 1);
+    CHECK_STR(_argv[0].s, "hello \"there\"  ");
+
+    char set[] = "set \"a b\"";
+    CHECK(shell.execute(set, out));
+    CHECK(_argc == 1);
+    CHECK_STR(_argv[0].s, "a b");
+
+    // every name is found, and only those
+    for (size_t i = 0; i < sizeof(_commands) / sizeof(_commands[0]); i++)
+        CHECK(shell._find(_commands[i].name) == &_commands[i]);
+    CHECK(shell._find("") == NULL);
+    CHECK(shell._find("a") == NULL);
+    CHECK(shell._find("zzz") == NULL);
+
+    out.text.clear();
+    char unknown[] = "sat";
+    CHECK(!shell.execute(unknown, out));
+    CHECK(out.text == "Unknown command: sat\r\n");
+
+    out.text.clear();
+    char missing[] = "poke ff";
+    CHECK(!shell.execute(missing, out));
+    CHECK(out.text == "Missing argument for poke\r\n");
+
+    out.text.clear();
+    char bad[] = "poke ff -1";
+    CHECK(!shell.execute(bad, out));
+    CHECK(out.text == "Bad argument: -1\r\n");
+
+    out.text.clear();
+    char extra[] = "set a b c";
+    CHECK(!shell.execute(extra, out));
+    CHECK(out.text == "Too many arguments for set\r\n");
+}
+
+/*
+    TelnetCapabilityCache
+*/
+
+static TelnetCapabilities _profile(uint32_t addr, const char *termType, uint16_t cols)
+{
+    TelnetCapabilities caps;
+
+    memset(&caps, 0, sizeof(caps));
+    caps.addr = addr;
+    strcpy(caps.termType, termType);
+    caps.cols = cols;
+    return caps;
+}
+
+static void testCapabilityCache()
+{
+    TelnetCapabilityCache cache;
+
+    for (uint32_t addr = 1; addr <= TELNET_CAPABILITY_CACHE_SIZE; addr++)
+        cache.store(_profile(addr, "XTERM", 80));
+
+    // a lookup makes 1 the most recently used, so 2 goes first
+    CHECK(cache.find(1) != NULL);
+    cache.store(_profile(100, "XTERM", 80));
+    CHECK(cache.find(2) == NULL);
+    CHECK(cache.find(1) != NULL);
+    CHECK(cache.find(100) != NULL);
+
+    // storing the same address and type again updates it in place
+    cache.store(_profile(3, "xterm", 132));
+    const TelnetCapabilities *caps = cache.find(3, "XTERM");
+    CHECK(caps != NULL && caps->cols == 132);
+
+    // 4 is now the oldest
+    cache.store(_profile(101, "VT100", 80));
+    CHECK(cache.find(4) == NULL);
+    CHECK(cache.find(3) != NULL);
+
+    // an address with two terminals, find() prefers the last one used
+    CHECK(cache.find(1, "XTERM") != NULL);
+    cache.store(_profile(1, "VT100", 40));
+    caps = cache.find(1);
+    CHECK(caps != NULL && strcmp(caps->termType, "VT100") == 0);
+    CHECK(cache.find(1, "XTERM") != NULL);
+    caps = cache.find(1);
+    CHECK(caps != NULL && strcmp(caps->termType, "XTERM") == 0);
+    CHECK(cache.find(1, "ANSI") == NULL);
+
+    cache.clear();
+    CHECK(cache.find(1) == NULL);
+}
+
+/*
+    TIMING-MARK round trip
+*/
+
+// exposes the round trip estimate to the tests
+class RttProbe : public TelnetServer
+{
+public:
+
+    using TelnetServer::_updateRtt;
+};
+
+static void testRtt()
+{
+    TelnetServer::ClientStruct str;
+    str.srtt = 0;
+    str.flushDelay = 0;
+
+    // the first sample is taken as is
+    RttProbe::_updateRtt(str, 100);
+    CHECK(str.srtt == 100);
+    CHECK(str.flushDelay == 25);
+
+    // then 7/8 of the old estimate and 1/8 of the sample
+    RttProbe::_updateRtt(str, 20);
+    CHECK(str.srtt == 90);
+    CHECK(str.flushDelay == 22);
+
+    // slow links hold output no longer than TELNET_TM_MAX_FLUSH_DELAY
+    str.srtt = 0;
+    RttProbe::_updateRtt(str, 1000);
+    CHECK(str.flushDelay == TELNET_TM_MAX_FLUSH_DELAY);
+
+    // fast ones not at all
+    str.srtt = 0;
+    RttProbe::_updateRtt(str, TELNET_TM_FAST_RTT - 1);
+    CHECK(str.flushDelay == 0);
+
+    // a sample of 0 still counts as measured, an absurd one is clamped
+    str.srtt = 0;
+    RttProbe::_updateRtt(str, 0);
+    CHECK(str.srtt == 1);
+    str.srtt = 0;
+    RttProbe::_updateRtt(str, 100000);
+    CHECK(str.srtt == 0xffff);
+
+    // over a live connection, a probe goes out as the client connects
+    // and then every TELNET_TM_PROBE_INTERVAL, the answers are timed
+    SizedTelnetServer<16> server(23);
+    TelnetServer::ClientBuffers<32, 64> client;
+
+    server.begin(client);
+    _connect(server);
+    CHECK(HostNet::output.find("\xff\xfd\x06") != std::string::npos);
+    CHECK(server.rtt() == 0);
+
+    HostNet::now += 60;
+    _send("\xff\xfc\x06");
+    server.handleClient();
+    CHECK(server.rtt() == 60);
+
+    // no new probe while the interval runs
+    HostNet::output.clear();
+    HostNet::now += TELNET_TM_PROBE_INTERVAL - 61;
+    server.handleClient();
+    CHECK(HostNet::output.empty());
+
+    HostNet::now += 1;
+    server.handleClient();
+    CHECK(HostNet::output == "\xff\xfd\x06");
+
+    HostNet::now += 20;
+    _send("\xff\xfb\x06");
+    server.handleClient();
+    CHECK(server.rtt() == 55);
+
+    _disconnect(server);
+    server.end();
+}
+
+/*
+    sessions restart per client
+*/
+
+// reads one line, then echoes every line back tagged with it
+class EchoTask : public TelnetTask
+{
+public:
+
+    int starts;
+    char tag[16];
+
+    EchoTask() : starts(0) {}
+
+protected:
+
+    char *line;
+
+    virtual char run(SimpleTelnetServer &t)
+    {
+        TELNET_TASK_BEGIN();
+
+        starts++;
+        TELNET_TASK_READ_LINE(t, line);
+        strcpy(tag, line);
+
+        for (;;)
+        {
+            TELNET_TASK_READ_LINE(t, line);
+            if (strcmp(line, "quit") == 0)
+                TELNET_TASK_EXIT();
+            TELNET_TASK_WRITE(t, tag);
+        }
+
+        TELNET_TASK_END();
+    }
+};
+
+static void testTaskRestart()
+{
+    SizedTelnetServer<16> server(23);
+    TelnetServer::ClientBuffers<32, 64> client;
+    EchoTask task;
+
+    server.setPassive(true);
+    server.begin(client);
+
+    // nothing runs without a client
+    task.poll(server);
+    CHECK(task.starts == 0);
+
+    _connect(server);
+    _send("first\r\n");
+    server.handleClient();
+    task.poll(server);
+    CHECK(task.starts == 1);
+    CHECK_STR(task.tag, "first");
+
+    // the next client starts from the top, not where the last one left
+    _disconnect(server);
+    task.poll(server);
+    _connect(server);
+    task.poll(server);
+    CHECK(task.starts == 2);
+
+    _send("second\r\nx\r\n");
+    server.handleClient();
+    task.poll(server);
+    task.poll(server);
+    server.handleClient();
+    CHECK_STR(task.tag, "second");
+    CHECK(HostNet::output == "second");
+
+    // a finished task rests until the next client
+    _send("quit\r\n");
+    server.handleClient();
+    task.poll(server);
+    CHECK(task.done());
+    task.poll(server);
+    CHECK(task.starts == 2);
+
+    _disconnect(server);
+    _connect(server);
+    task.poll(server);
+    CHECK(!task.done());
+    CHECK(task.starts == 3);
+
+    _disconnect(server);
+    server.end();
+}
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+static int _coStarts;
+static char _coTag[16];
+
+static TelnetCoroutine _echo(SimpleTelnetServer &t)
+{
+    _coStarts++;
+
+    char *line = co_await TelnetReadLine(t);
+    strcpy(_coTag, line);
+
+    for (;;)
+    {
+        line = co_await TelnetReadLine(t);
+        if (strcmp(line, "quit") == 0)
+            co_return;
+        co_await TelnetWrite(t, _coTag);
+    }
+}
+
+static void testCoroutineRestart()
+{
+    SizedTelnetServer<16> server(23);
+    TelnetServer::ClientBuffers<32, 64> client;
+    TelnetCoroutineTask task(_echo);
+
+    server.setPassive(true);
+    server.begin(client);
+
+    _connect(server);
+    _send("first\r\n");
+    server.handleClient();
+    task.poll(server);
+    task.poll(server);
+    CHECK(_coStarts == 1);
+    CHECK_STR(_coTag, "first");
+
+    _disconnect(server);
+    _connect(server);
+    task.poll(server);
+    CHECK(_coStarts == 2);
+
+    _send("second\r\nx\r\nquit\r\n");
+    server.handleClient();
+    for (int i = 0; i < 4; i++)
+        task.poll(server);
+    server.handleClient();
+    CHECK_STR(_coTag, "second");
+    CHECK(HostNet::output == "second");
+    CHECK(task.done());
+
+    _disconnect(server);
+    _connect(server);
+    task.poll(server);
+    CHECK(!task.done());
+    CHECK(_coStarts == 3);
+
+    _disconnect(server);
+    server.end();
+}
+
+#endif
+
+int main()
+{
+    testReadLine();
+    testTokenizer();
+    testNumbers();
+    testShell();
+    testCapabilityCache();
+    testRtt();
+    testTaskRestart();
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+    testCoroutineRestart();
+#endif
+
+    printf("%d checks, %d failed\n", _checks, _failures);
+    return _failures == 0 ? 0 : 1;
+}
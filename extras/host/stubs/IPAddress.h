@@ -0,0 +1,19 @@
+#ifndef _HOST_IPADDRESS_h
+#define _HOST_IPADDRESS_h
+
+#include "arduino.h"
+
+class IPAddress
+{
+public:
+
+    IPAddress(uint32_t addr = 0);
+
+    operator uint32_t() const;
+
+private:
+
+    uint32_t _addr;
+};
+
+#endif
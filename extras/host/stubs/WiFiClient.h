@@ -0,0 +1,34 @@
+#ifndef _HOST_WIFICLIENT_h
+#define _HOST_WIFICLIENT_h
+
+#include "arduino.h"
+#include "IPAddress.h"
+
+class WiFiClient : public Print
+{
+    friend class WiFiServer;
+
+public:
+
+    WiFiClient();
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buf, size_t size);
+    using Print::write;
+
+    int available();
+    int read();
+    uint8_t connected();
+    void stop();
+    void setNoDelay(bool nodelay);
+    IPAddress remoteIP();
+
+    operator bool();
+
+private:
+
+    // a client the server handed out, until stop()
+    bool _open;
+};
+
+#endif
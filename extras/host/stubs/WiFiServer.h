@@ -0,0 +1,25 @@
+#ifndef _HOST_WIFISERVER_h
+#define _HOST_WIFISERVER_h
+
+#include "WiFiClient.h"
+
+enum { CLOSED = 0 };
+
+class WiFiServer
+{
+public:
+
+    WiFiServer(uint16_t port);
+
+    void begin();
+    void close();
+    uint8_t status();
+    bool hasClient();
+    WiFiClient available(uint8_t *status = NULL);
+
+private:
+
+    bool _listening;
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+    Just enough of the Arduino core to build the library on the build
+    host, see ../Makefile.  stubs.cpp implements it over the fake network
+    of host.h, for the tests.
+*/
+
+#ifndef _HOST_ARDUINO_h
+#define _HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define HEX 16
+
+typedef uint8_t byte;
+
+unsigned long millis();
+
+class Print
+{
+public:
+
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size);
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+    size_t print(const char *s);
+    size_t print(unsigned long n, int base = 10);
+    size_t println();
+    size_t println(const char *s);
+    size_t println(unsigned long n, int base = 10);
+};
+
+#endif
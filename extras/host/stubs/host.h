@@ -0,0 +1,34 @@
+/*
+    The fake network behind the stubs, one connection at a time, driven
+    by the tests.  See stubs.cpp.
+*/
+
+#ifndef _HOST_HOST_h
+#define _HOST_HOST_h
+
+#include <string>
+
+#include "arduino.h"
+
+struct HostNet
+{
+    // what millis() returns
+    static unsigned long now;
+
+    // a client waits to be accepted, refused when it is gone by then
+    static bool pending;
+    static bool refused;
+
+    // the accepted client is still there, and its address
+    static bool connected;
+    static uint32_t remoteIP;
+
+    // bytes from the client not read yet, and bytes sent to it
+    static std::string input;
+    static std::string output;
+
+    // a new client calling in, with nothing sent either way yet
+    static void connect(uint32_t ip);
+};
+
+#endif
@@ -0,0 +1,171 @@
+/*
+    The Arduino core of the stub headers, over the fake network of host.h.
+*/
+
+#include "host.h"
+#include "WiFiServer.h"
+
+unsigned long HostNet::now = 1;
+bool HostNet::pending = false;
+bool HostNet::refused = false;
+bool HostNet::connected = false;
+uint32_t HostNet::remoteIP = 0;
+std::string HostNet::input;
+std::string HostNet::output;
+
+void HostNet::connect(uint32_t ip)
+{
+    pending = true;
+    refused = false;
+    connected = true;
+    remoteIP = ip;
+    input.clear();
+    output.clear();
+}
+
+unsigned long millis()
+{
+    return HostNet::now;
+}
+
+size_t Print::write(const uint8_t *buf, size_t size)
+{
+    size_t n = 0;
+
+    while (size--)
+        n += write(*buf++);
+
+    return n;
+}
+
+size_t Print::print(const char *s)
+{
+    return write(s);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    char buf[24];
+
+    snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%lu", n);
+    return write(buf);
+}
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::println(const char *s)
+{
+    return print(s) + println();
+}
+
+size_t Print::println(unsigned long n, int base)
+{
+    return print(n, base) + println();
+}
+
+IPAddress::IPAddress(uint32_t addr) :
+    _addr(addr)
+{
+}
+
+IPAddress::operator uint32_t() const
+{
+    return _addr;
+}
+
+WiFiClient::WiFiClient() :
+    _open(false)
+{
+}
+
+size_t WiFiClient::write(uint8_t c)
+{
+    HostNet::output += (char)c;
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+    HostNet::output.append((const char *)buf, size);
+    return size;
+}
+
+int WiFiClient::available()
+{
+    return _open ? HostNet::input.size() : 0;
+}
+
+int WiFiClient::read()
+{
+    if (!_open || HostNet::input.empty())
+        return -1;
+
+    int c = (uint8_t)HostNet::input[0];
+    HostNet::input.erase(0, 1);
+    return c;
+}
+
+uint8_t WiFiClient::connected()
+{
+    return _open && HostNet::connected;
+}
+
+void WiFiClient::stop()
+{
+    _open = false;
+}
+
+void WiFiClient::setNoDelay(bool nodelay)
+{
+}
+
+IPAddress WiFiClient::remoteIP()
+{
+    return IPAddress(HostNet::remoteIP);
+}
+
+WiFiClient::operator bool()
+{
+    return _open;
+}
+
+WiFiServer::WiFiServer(uint16_t port) :
+    _listening(false)
+{
+}
+
+void WiFiServer::begin()
+{
+    _listening = true;
+}
+
+void WiFiServer::close()
+{
+    _listening = false;
+}
+
+uint8_t WiFiServer::status()
+{
+    return _listening ? 1 : CLOSED;
+}
+
+bool WiFiServer::hasClient()
+{
+    return _listening && HostNet::pending;
+}
+
+WiFiClient WiFiServer::available(uint8_t *status)
+{
+    WiFiClient client;
+
+    if (_listening && HostNet::pending)
+    {
+        HostNet::pending = false;
+        client._open = !HostNet::refused;
+    }
+
+    return client;
+}